@@ -1,8 +1,27 @@
+#define _GNU_SOURCE // sched_getcpu
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <omp.h>
 
+#include "bench.h"
+#include "perfcount.h"
+#include "stream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
 //#define MATRIX_COLS 40000 // 20000 или 40000
 //#define MATRIX_ROWS MATRIX_COLS
 //#define MAX_THREADS 40 // 1, 2, 4, 7, 8, 16, 20, 40
@@ -15,24 +34,153 @@ double cpuSecond() {
 
 
 
+// === NUMA: топология, привязка потоков и статистика по узлам ===
+
+#define MAX_CPUS 1024
+#define MAX_NODES 64
+#define MAX_STAT_THREADS 1024
+
+static int cpu_node[MAX_CPUS]; // номер NUMA-узла для каждого CPU
+static int num_nodes = 1;
+
+void load_numa_topology() {
+    // читаем /sys/devices/system/node/nodeN/cpulist (формат "0-3,8-11");
+    // если sysfs недоступен, считаем, что узел один
+    memset(cpu_node, 0, sizeof(cpu_node));
+    for (int node = 0; node < MAX_NODES; node++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            continue;
+        }
+        int lo, hi;
+        char sep;
+        while (fscanf(f, "%d", &lo) == 1) {
+            hi = lo;
+            if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+                if (fscanf(f, "%d", &hi) != 1) {
+                    hi = lo;
+                }
+                if (fscanf(f, "%c", &sep) != 1) {
+                    sep = '\n';
+                }
+            }
+            for (int cpu = lo; cpu <= hi && cpu < MAX_CPUS; cpu++) {
+                cpu_node[cpu] = node;
+            }
+            if (node + 1 > num_nodes) {
+                num_nodes = node + 1;
+            }
+            if (sep != ',') {
+                break;
+            }
+        }
+        fclose(f);
+    }
+}
+
+int node_of_cpu(int cpu) {
+    return (cpu >= 0 && cpu < MAX_CPUS) ? cpu_node[cpu] : 0;
+}
+
+void setup_omp_affinity(const char *bind, char *argv[]) {
+    // OMP_PLACES/OMP_PROC_BIND читаются рантаймом один раз при запуске,
+    // поэтому, если пользователь их не задал, выставляем и перезапускаемся
+    if (strcmp(bind, "none") == 0 || getenv("OMP_PLACES") || getenv("OMP_PROC_BIND")) {
+        return;
+    }
+    setenv("OMP_PLACES", "cores", 1);
+    setenv("OMP_PROC_BIND", bind, 1);
+    execv("/proc/self/exe", argv);
+    perror("execv"); // не получилось - работаем без привязки
+}
+
+// каждый поток делит строки одинаково и при инициализации (first-touch),
+// и при вычислениях, чтобы страницы a лежали на узле "своего" потока
+void thread_range(int cols, int *lb, int *ub) {
+    int nthreads = omp_get_num_threads();
+    int threadid = omp_get_thread_num();
+    int items_per_thread = cols / nthreads;
+    *lb = threadid * items_per_thread;
+    *ub = (threadid == nthreads - 1) ? (cols - 1) : (*lb + items_per_thread - 1);
+}
+
+typedef struct {
+    int lb, ub, cpu, place;
+    double seconds;
+} thread_stat_t;
+
+static thread_stat_t thread_stats[MAX_STAT_THREADS];
+static int thread_stats_count = 0;
+
+void record_thread_stat(int lb, int ub, double seconds) {
+    int threadid = omp_get_thread_num();
+    if (threadid < MAX_STAT_THREADS) {
+        thread_stat_t st = { lb, ub, sched_getcpu(), omp_get_place_num(), seconds };
+        thread_stats[threadid] = st;
+    }
+    if (threadid == 0) {
+        thread_stats_count = omp_get_num_threads();
+    }
+}
+
+void print_placement_report() {
+    printf("Placement (OMP_PLACES=%s, OMP_PROC_BIND=%s):\n",
+           getenv("OMP_PLACES") ? getenv("OMP_PLACES") : "unset",
+           getenv("OMP_PROC_BIND") ? getenv("OMP_PROC_BIND") : "unset");
+    for (int t = 0; t < thread_stats_count && t < MAX_STAT_THREADS; t++) {
+        thread_stat_t *st = &thread_stats[t];
+        printf("  thread %d -> cpu %d (node %d, place %d), rows %d..%d\n",
+               t, st->cpu, node_of_cpu(st->cpu), st->place, st->lb, st->ub);
+    }
+}
+
+void print_node_bandwidth(int rows, size_t elem_size) {
+    // узел считается закончившим работу, когда закончил его самый медленный поток
+    for (int node = 0; node < num_nodes; node++) {
+        double bytes = 0.0, seconds = 0.0;
+        int count = 0;
+        for (int t = 0; t < thread_stats_count && t < MAX_STAT_THREADS; t++) {
+            thread_stat_t *st = &thread_stats[t];
+            if (node_of_cpu(st->cpu) != node) {
+                continue;
+            }
+            bytes += elem_size * (double)(st->ub - st->lb + 1) * rows;
+            if (st->seconds > seconds) {
+                seconds = st->seconds;
+            }
+            count++;
+        }
+        if (count > 0) {
+            printf("    node %d: %.3f GB/s (%d threads)\n", node, bytes / seconds * 1.e-9, count);
+        }
+    }
+}
+
+
+
 void matrix_vector_product(double *a, double *b, double *c, int cols, int rows) {
+    int region = PERF_REGION("serial");
+    PERF_BEGIN(region);
     for (int i = 0; i < cols; i++) {
         c[i] = 0.0;
 
         for (int j = 0; j < rows; j++) {
-            c[i] += a[i * rows + j] * b[j];
+            c[i] += a[(size_t)i * rows + j] * b[j];
         }
     }
+    PERF_END(region);
 }
 
 void matrix_vector_product_omp(double *a, double *b, double *c, int cols, int rows) {
+    int region = PERF_REGION("omp");
     #pragma omp parallel
     {
-        int nthreads = omp_get_num_threads();
-        int threadid = omp_get_thread_num();
-        int items_per_thread = cols / nthreads;
-        int lb = threadid * items_per_thread;
-        int ub = (threadid == nthreads - 1) ? (cols - 1) : (lb + items_per_thread - 1);
+        int lb, ub;
+        thread_range(cols, &lb, &ub);
+        double t = omp_get_wtime();
+        PERF_BEGIN(region);
 
         // параллельно-вычисляемый цикл FOR,
         // каждый поток вычисляет только 1/n-тую
@@ -41,12 +189,302 @@ void matrix_vector_product_omp(double *a, double *b, double *c, int cols, int ro
             c[i] = 0.0; // Store – запись в память
             for (int j = 0; j < rows; j++) {
                 // Load c[i], Load a[i][j], Load b[j], Store c[i]
-                c[i] += a[i * rows + j] * b[j];
+                c[i] += a[(size_t)i * rows + j] * b[j];
+            }
+        }
+
+        PERF_END(region);
+        record_thread_stat(lb, ub, omp_get_wtime() - t);
+    }
+}
+
+
+
+// Блочная (register-blocked) версия: за один проход по b обрабатываем
+// сразу несколько строк a, поэтому b[j] грузится один раз на блок строк,
+// а частичные суммы живут в регистрах вместо постоянного Load/Store c[i].
+// Строки [lb, ub] включительно, как и в matrix_vector_product_omp.
+typedef void (*gemv_rows_t)(const double *a, const double *b, double *c, int lb, int ub, int rows);
+
+static void gemv_rows_scalar(const double *restrict a, const double *restrict b,
+                             double *restrict c, int lb, int ub, int rows) {
+    int i = lb;
+    for (; i + 3 <= ub; i += 4) {
+        const double *a0 = a + (size_t)i * rows;
+        const double *a1 = a0 + rows;
+        const double *a2 = a1 + rows;
+        const double *a3 = a2 + rows;
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+
+        #pragma omp simd reduction(+:s0, s1, s2, s3)
+        for (int j = 0; j < rows; j++) {
+            double bj = b[j];
+            s0 += a0[j] * bj;
+            s1 += a1[j] * bj;
+            s2 += a2[j] * bj;
+            s3 += a3[j] * bj;
+        }
+        c[i] = s0;
+        c[i + 1] = s1;
+        c[i + 2] = s2;
+        c[i + 3] = s3;
+    }
+    for (; i <= ub; i++) { // хвост, не кратный размеру блока
+        const double *ai = a + (size_t)i * rows;
+        double s = 0.0;
+        #pragma omp simd reduction(+:s)
+        for (int j = 0; j < rows; j++) {
+            s += ai[j] * b[j];
+        }
+        c[i] = s;
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2,fma")))
+static double hsum_avx2(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2,fma")))
+static void gemv_rows_avx2(const double *restrict a, const double *restrict b,
+                           double *restrict c, int lb, int ub, int rows) {
+    int i = lb;
+    for (; i + 3 <= ub; i += 4) {
+        const double *a0 = a + (size_t)i * rows;
+        const double *a1 = a0 + rows;
+        const double *a2 = a1 + rows;
+        const double *a3 = a2 + rows;
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+
+        int j = 0;
+        for (; j + 4 <= rows; j += 4) {
+            __m256d bj = _mm256_loadu_pd(b + j); // один Load b на 4 строки
+            s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a0 + j), bj, s0);
+            s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a1 + j), bj, s1);
+            s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a2 + j), bj, s2);
+            s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a3 + j), bj, s3);
+        }
+        double r0 = hsum_avx2(s0), r1 = hsum_avx2(s1);
+        double r2 = hsum_avx2(s2), r3 = hsum_avx2(s3);
+        for (; j < rows; j++) {
+            r0 += a0[j] * b[j];
+            r1 += a1[j] * b[j];
+            r2 += a2[j] * b[j];
+            r3 += a3[j] * b[j];
+        }
+        c[i] = r0;
+        c[i + 1] = r1;
+        c[i + 2] = r2;
+        c[i + 3] = r3;
+    }
+    if (i <= ub) {
+        gemv_rows_scalar(a, b, c, i, ub, rows);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void gemv_rows_avx512(const double *restrict a, const double *restrict b,
+                             double *restrict c, int lb, int ub, int rows) {
+    int i = lb;
+    for (; i + 7 <= ub; i += 8) {
+        const double *ar = a + (size_t)i * rows;
+        __m512d s[8];
+        for (int r = 0; r < 8; r++) {
+            s[r] = _mm512_setzero_pd();
+        }
+
+        int j = 0;
+        for (; j + 8 <= rows; j += 8) {
+            __m512d bj = _mm512_loadu_pd(b + j); // один Load b на 8 строк
+            for (int r = 0; r < 8; r++) {
+                s[r] = _mm512_fmadd_pd(_mm512_loadu_pd(ar + (size_t)r * rows + j), bj, s[r]);
             }
         }
+        for (int r = 0; r < 8; r++) {
+            double sum = _mm512_reduce_add_pd(s[r]);
+            for (int jj = j; jj < rows; jj++) {
+                sum += ar[(size_t)r * rows + jj] * b[jj];
+            }
+            c[i + r] = sum;
+        }
+    }
+    if (i <= ub) {
+        gemv_rows_avx2(a, b, c, i, ub, rows);
+    }
+}
+#endif
+
+static gemv_rows_t gemv_rows = gemv_rows_scalar;
+static const char *gemv_rows_name = "scalar";
+
+void select_gemv_kernel() {
+    // выбираем реализацию один раз по CPUID
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        gemv_rows = gemv_rows_avx512;
+        gemv_rows_name = "avx512";
+    }
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        gemv_rows = gemv_rows_avx2;
+        gemv_rows_name = "avx2";
+    }
+#endif
+}
+
+void matrix_vector_product_omp_blocked(double *a, double *b, double *c, int cols, int rows) {
+    int region = PERF_REGION(gemv_rows_name);
+    #pragma omp parallel
+    {
+        int lb, ub;
+        thread_range(cols, &lb, &ub);
+        double t = omp_get_wtime();
+
+        PERF_BEGIN(region);
+        gemv_rows(a, b, c, lb, ub, rows);
+        PERF_END(region);
+
+        record_thread_stat(lb, ub, omp_get_wtime() - t);
+    }
+}
+
+
+
+// === Хранение матрицы в пониженной точности (float / bf16) ===
+// Матрица хранится в float или bf16, а b, c и накопление суммы остаются
+// в double - так вдвое (вчетверо) меньше трафика памяти при почти той же
+// точности. Погрешность обязательно печатаем: см. Дополнительно/1_floatAscDescPrecision.c
+
+typedef enum { PREC_DOUBLE, PREC_FLOAT, PREC_BF16 } precision_t;
+static const char *precision_names[] = { "double", "float", "bf16" };
+static const size_t precision_sizes[] = { sizeof(double), sizeof(float), sizeof(uint16_t) };
+
+typedef uint16_t bf16_t; // bfloat16 - старшие 16 бит float
+
+static inline bf16_t float_to_bf16(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    u += 0x7FFF + ((u >> 16) & 1); // округление к ближайшему чётному
+    return (bf16_t)(u >> 16);
+}
+
+static inline double bf16_to_double(bf16_t h) {
+    uint32_t u = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+#define LOAD_FLOAT(x) ((double)(x))
+#define LOAD_BF16(x) bf16_to_double(x)
+
+// "шаблон" блочного ядра для произвольного типа хранения T:
+// 4 строки за проход, общий Load b[j], накопление в double
+#define DEFINE_GEMV_ROWS_MIXED(NAME, T, LOAD)                                     \
+static void NAME(const T *restrict a, const double *restrict b,                  \
+                 double *restrict c, int lb, int ub, int rows) {                 \
+    int i = lb;                                                                   \
+    for (; i + 3 <= ub; i += 4) {                                                 \
+        const T *a0 = a + (size_t)i * rows;                                       \
+        const T *a1 = a0 + rows;                                                  \
+        const T *a2 = a1 + rows;                                                  \
+        const T *a3 = a2 + rows;                                                  \
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;                            \
+        _Pragma("omp simd reduction(+:s0, s1, s2, s3)")                           \
+        for (int j = 0; j < rows; j++) {                                          \
+            double bj = b[j];                                                     \
+            s0 += LOAD(a0[j]) * bj;                                               \
+            s1 += LOAD(a1[j]) * bj;                                               \
+            s2 += LOAD(a2[j]) * bj;                                               \
+            s3 += LOAD(a3[j]) * bj;                                               \
+        }                                                                         \
+        c[i] = s0;                                                                \
+        c[i + 1] = s1;                                                            \
+        c[i + 2] = s2;                                                            \
+        c[i + 3] = s3;                                                            \
+    }                                                                             \
+    for (; i <= ub; i++) {                                                        \
+        const T *ai = a + (size_t)i * rows;                                       \
+        double s = 0.0;                                                           \
+        _Pragma("omp simd reduction(+:s)")                                        \
+        for (int j = 0; j < rows; j++) {                                          \
+            s += LOAD(ai[j]) * b[j];                                              \
+        }                                                                         \
+        c[i] = s;                                                                 \
+    }                                                                             \
+}
+
+DEFINE_GEMV_ROWS_MIXED(gemv_rows_f32, float, LOAD_FLOAT)
+DEFINE_GEMV_ROWS_MIXED(gemv_rows_bf16, bf16_t, LOAD_BF16)
+
+void matrix_vector_product_omp_mixed(const void *a, precision_t prec, double *b, double *c, int cols, int rows) {
+    int region = PERF_REGION(precision_names[prec]);
+    #pragma omp parallel
+    {
+        int lb, ub;
+        thread_range(cols, &lb, &ub);
+        double t = omp_get_wtime();
+        PERF_BEGIN(region);
+
+        if (prec == PREC_FLOAT) {
+            gemv_rows_f32((const float *)a, b, c, lb, ub, rows);
+        }
+        else if (prec == PREC_BF16) {
+            gemv_rows_bf16((const bf16_t *)a, b, c, lb, ub, rows);
+        }
+        else {
+            gemv_rows((const double *)a, b, c, lb, ub, rows);
+        }
+
+        PERF_END(region);
+        record_thread_stat(lb, ub, omp_get_wtime() - t);
     }
 }
 
+// Элемент тестовой матрицы: (i + j) / 3, а не i + j - целые до 2^24
+// float хранит точно, и погрешность хранения была бы не видна
+static inline double matrix_entry(int i, int j) {
+    return (i + j) / 3.0;
+}
+
+static double last_rel_error = 0.0, last_max_rel_error = 0.0; // погрешность последнего запуска
+
+void measure_error_against(const double *c, const double *ref, int cols) {
+    double num = 0.0, den = 0.0, max_rel = 0.0;
+    for (int i = 0; i < cols; i++) {
+        double diff = c[i] - ref[i];
+        num += diff * diff;
+        den += ref[i] * ref[i];
+        if (ref[i] != 0.0 && fabs(diff) / fabs(ref[i]) > max_rel) {
+            max_rel = fabs(diff) / fabs(ref[i]);
+        }
+    }
+    last_rel_error = (den > 0.0) ? sqrt(num / den) : 0.0;
+    last_max_rel_error = max_rel;
+}
+
+void measure_relative_error(const double *c, int cols, int rows) {
+    // для a[i][j] = (i + j) / 3 и b[j] = j точный ответ известен:
+    // c[i] = (i * sum(j) + sum(j^2)) / 3 - округление только в делении
+    double s1 = (double)rows * (rows - 1) / 2;
+    double s2 = (double)(rows - 1) * rows * (2.0 * rows - 1) / 6;
+    double *ref = malloc(sizeof(*ref) * cols);
+    for (int i = 0; i < cols; i++) {
+        ref[i] = (i * s1 + s2) / 3.0;
+    }
+    measure_error_against(c, ref, cols);
+    free(ref);
+}
+
+void print_relative_error() {
+    printf("    relative error: %.3e (max per-row %.3e)\n", last_rel_error, last_max_rel_error);
+}
+
 
 
 double run_serial(int cols, int rows) {
@@ -57,7 +495,7 @@ double run_serial(int cols, int rows) {
 
     for (int i = 0; i < cols; i++) {
         for (int j = 0; j < rows; j++) {
-            a[i * rows + j] = i + j;
+            a[(size_t)i * rows + j] = matrix_entry(i, j);
         }
     }
     for (int j = 0; j < rows; j++) {
@@ -74,7 +512,27 @@ double run_serial(int cols, int rows) {
     return t * 1000; // возвращаем значение в мс
 }
 
-double run_parallel(int cols, int rows) {
+typedef void (*gemv_kernel_t)(double *a, double *b, double *c, int cols, int rows);
+
+static stream_table_t calibration; // таблица --calibrate; пустая - доли не печатаются
+
+void print_throughput(const char *name, double t_ms, int cols, int rows, size_t elem_size, int threads) {
+    // GEMV: 2 флопа на элемент a, a читается ровно один раз
+    double flops = 2.0 * cols * rows;
+    double bytes = elem_size * (double)cols * rows + sizeof(double) * ((double)rows + cols);
+    printf("  [%s] %.3f GFLOP/s, %.3f GB/s\n", name,
+           flops / (t_ms * 1.e6), bytes / (t_ms * 1.e6));
+    // доля от STREAM на том же числе потоков; она же - потолок roofline в --perf
+    const stream_result_t *calib = stream_lookup(&calibration, threads);
+    if (calib) {
+        stream_print_fraction(&calibration, name, bytes / (t_ms * 1.e6), threads);
+        perf_set_stream_bandwidth(stream_attainable(calib, NULL));
+    }
+    // --perf: счётчики и roofline участка с тем же именем (perfcount.h)
+    perf_print_region(PERF_REGION(name), flops, bytes, t_ms);
+}
+
+double run_parallel(int cols, int rows, gemv_kernel_t kernel) {
     double *a, *b, *c;
     a = malloc(sizeof(*a) * cols * rows);
     b = malloc(sizeof(*b) * rows);
@@ -82,30 +540,77 @@ double run_parallel(int cols, int rows) {
 
     #pragma omp parallel
     {
-        int nthreads = omp_get_num_threads();
-        int threadid = omp_get_thread_num();
-        int items_per_thread = cols / nthreads;
-        int lb = threadid * items_per_thread;
-        int ub = (threadid == nthreads - 1) ? (cols - 1) : (lb + items_per_thread - 1);
+        int lb, ub;
+        thread_range(cols, &lb, &ub);
 
         // параллельно-вычисляемый цикл FOR,
         // каждый поток вычисляет только 1/n-тую
-        // часть всех значений (от lb до ub)
+        // часть всех значений (от lb до ub) - с тем же
+        // разбиением, что и в умножении (first-touch)
         for (int i = lb; i <= ub; i++) {
             for (int j = 0; j < rows; j++) {
-                a[i * rows + j] = i + j;
+                a[(size_t)i * rows + j] = matrix_entry(i, j);
             }
             c[i] = 0.0;
         }
+
+        // b читают все потоки - раскладываем его по узлам вперемешку
+        #pragma omp for schedule(static, 512)
+        for (int j = 0; j < rows; j++) {
+            b[j] = j;
+        }
     }
-    for (int j = 0; j < rows; j++) {
-        b[j] = j;
+
+    double t = cpuSecond();
+    kernel(a, b, c, cols, rows);
+    t = cpuSecond() - t;
+
+    measure_relative_error(c, cols, rows);
+
+    free(a);
+    free(b);
+    free(c);
+    return t * 1000; // возвращаем значение в мс
+}
+
+
+
+double run_parallel_mixed(int cols, int rows, precision_t prec) {
+    void *a = malloc(precision_sizes[prec] * cols * rows);
+    double *b = malloc(sizeof(*b) * rows);
+    double *c = malloc(sizeof(*c) * cols);
+
+    #pragma omp parallel
+    {
+        int lb, ub;
+        thread_range(cols, &lb, &ub);
+
+        // first-touch тем же разбиением, что и в умножении
+        for (int i = lb; i <= ub; i++) {
+            for (int j = 0; j < rows; j++) {
+                size_t k = (size_t)i * rows + j;
+                if (prec == PREC_FLOAT) {
+                    ((float *)a)[k] = (float)matrix_entry(i, j);
+                }
+                else {
+                    ((bf16_t *)a)[k] = float_to_bf16((float)matrix_entry(i, j));
+                }
+            }
+            c[i] = 0.0;
+        }
+
+        #pragma omp for schedule(static, 512)
+        for (int j = 0; j < rows; j++) {
+            b[j] = j;
+        }
     }
 
     double t = cpuSecond();
-    matrix_vector_product_omp(a, b, c, cols, rows);
+    matrix_vector_product_omp_mixed(a, prec, b, c, cols, rows);
     t = cpuSecond() - t;
 
+    measure_relative_error(c, cols, rows);
+
     free(a);
     free(b);
     free(c);
@@ -114,30 +619,750 @@ double run_parallel(int cols, int rows) {
 
 
 
-int main() {
+// === Неявная матрица: c = A*b без хранения A ===
+// Для синтетических тестов матрица - функция индексов, поэтому её можно
+// генерировать на лету: память O(n) вместо O(n^2), и размеры 200K+
+// перестают упираться в malloc.
+
+// генератор куска строки: out[k] = a[i][j0 + k], k < count
+typedef void (*matrix_row_gen_t)(int i, int j0, int count, double *out, const void *ctx);
+
+typedef enum {
+    OP_GENERATOR,  // произвольная матрица через генератор
+    OP_TOEPLITZ,   // a[i][j] = t[i - j + rows - 1], t длины cols + rows - 1
+    OP_RANK1_DIAG  // a = u * v^T + diag(d), как в prepare_values Задания 2.3
+} matrix_op_kind_t;
+
+typedef struct {
+    matrix_op_kind_t kind;
+    int cols, rows;
+    matrix_row_gen_t gen;
+    const void *ctx;
+    const double *t;
+    const double *u, *v, *d;
+} matrix_op_t;
+
+#define GEN_TILE 1024 // кусок строки, генерируемый за раз (8 КБ - живёт в L1)
+
+void matrix_op_apply(const matrix_op_t *op, const double *b, double *c) {
+    int cols = op->cols, rows = op->rows;
+
+    if (op->kind == OP_RANK1_DIAG) {
+        // c = u * (v . b) + d * b - O(n) вместо O(n^2)
+        double vb = 0.0;
+        #pragma omp parallel for schedule(static) reduction(+:vb)
+        for (int j = 0; j < rows; j++) {
+            vb += op->v[j] * b[j];
+        }
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < cols; i++) {
+            c[i] = op->u[i] * vb + ((i < rows) ? op->d[i] * b[i] : 0.0);
+        }
+        return;
+    }
+
+    #pragma omp parallel
+    {
+        int lb, ub;
+        thread_range(cols, &lb, &ub);
+        double t0 = omp_get_wtime();
+        double tile[GEN_TILE];
+
+        for (int i = lb; i <= ub; i++) {
+            double sum = 0.0;
+            if (op->kind == OP_TOEPLITZ) {
+                const double *ti = op->t + i + rows - 1; // a[i][j] = ti[-j]
+                #pragma omp simd reduction(+:sum)
+                for (int j = 0; j < rows; j++) {
+                    sum += ti[-j] * b[j];
+                }
+            }
+            else {
+                for (int j0 = 0; j0 < rows; j0 += GEN_TILE) {
+                    int count = (rows - j0 < GEN_TILE) ? rows - j0 : GEN_TILE;
+                    op->gen(i, j0, count, tile, op->ctx);
+                    #pragma omp simd reduction(+:sum)
+                    for (int k = 0; k < count; k++) {
+                        sum += tile[k] * b[j0 + k];
+                    }
+                }
+            }
+            c[i] = sum;
+        }
+
+        record_thread_stat(lb, ub, omp_get_wtime() - t0);
+    }
+}
+
+// a[i][j] = i + j: генератор отдаёт double, хранения и его округления
+// нет, поэтому деление на 3 из matrix_entry() здесь не нужно
+void gen_i_plus_j(int i, int j0, int count, double *out, const void *ctx) {
+    (void)ctx;
+    #pragma omp simd
+    for (int k = 0; k < count; k++) {
+        out[k] = (double)i + (double)(j0 + k);
+    }
+}
+
+double run_implicit(int n, matrix_op_kind_t kind) {
+    double *b = malloc(sizeof(*b) * n);
+    double *c = malloc(sizeof(*c) * n);
+    double *ref = malloc(sizeof(*ref) * n);
+    double *t = NULL, *u = NULL, *d = NULL;
+
+    for (int j = 0; j < n; j++) {
+        b[j] = j;
+    }
+    double s1 = (double)n * (n - 1) / 2;
+    double s2 = (double)(n - 1) * n * (2.0 * n - 1) / 6;
+
+    matrix_op_t op = { kind, n, n, NULL, NULL, NULL, NULL, NULL, NULL };
+    if (kind == OP_GENERATOR) {
+        op.gen = gen_i_plus_j;
+        for (int i = 0; i < n; i++) {
+            ref[i] = i * s1 + s2;
+        }
+    }
+    else if (kind == OP_TOEPLITZ) {
+        // t[k] = k, т.е. a[i][j] = i - j + n - 1
+        t = malloc(sizeof(*t) * (2 * (size_t)n - 1));
+        for (int k = 0; k < 2 * n - 1; k++) {
+            t[k] = k;
+        }
+        op.t = t;
+        for (int i = 0; i < n; i++) {
+            ref[i] = (double)(i + n - 1) * s1 - s2;
+        }
+    }
+    else {
+        // матрица Задания 2.3: единицы плюс единичная диагональ (2.0 на диагонали)
+        u = malloc(sizeof(*u) * n);
+        d = malloc(sizeof(*d) * n);
+        for (int i = 0; i < n; i++) {
+            u[i] = 1.0;
+            d[i] = 1.0;
+        }
+        op.u = u;
+        op.v = u;
+        op.d = d;
+        for (int i = 0; i < n; i++) {
+            ref[i] = s1 + i;
+        }
+    }
+
+    double time = cpuSecond();
+    matrix_op_apply(&op, b, c);
+    time = cpuSecond() - time;
+
+    measure_error_against(c, ref, n);
+
+    free(b);
+    free(c);
+    free(ref);
+    free(t);
+    free(u);
+    free(d);
+    return time * 1000; // возвращаем значение в мс
+}
+
+void run_implicit_sweep(int n, const bench_config_t *bench, bench_report_t *report) {
+    const char *names[] = { "generator", "toeplitz", "rank1+diag" };
+    printf("\n=== IMPLICIT MATRIX (%d x %d, never materialized) ===\n", n, n);
+    for (int i = 0; i < bench->nthreads; i++) {
+        omp_set_num_threads(bench->threads[i]);
+        printf("Number of threads: %d\n", omp_get_max_threads());
+        for (int k = OP_GENERATOR; k <= OP_RANK1_DIAG; k++) {
+            bench_stats_t st;
+            BENCH_MEASURE(bench, st, run_implicit(n, k));
+            bench_record(report, names[k], NULL, n, bench->threads[i], st);
+            double result = st.median;
+            printf("%dK %s elapsed time: %.6f ms\n", n / 1000, names[k], result);
+            // GFLOP/s считаем как для обычного GEMV с той же матрицей
+            printf("  [%s] %.3f GFLOP/s (dense-equivalent), %.1f MB used\n", names[k],
+                   2.0 * n * (double)n / (result * 1.e6), sizeof(double) * 4.0 * n / 1.e6);
+            print_relative_error();
+        }
+        printf("------\n");
+    }
+}
+
+
+
+// === Матрица из файла: mmap или потоковое чтение панелями ===
+// Формат: заголовок matrix_file_header_t, дополненный до 4 КБ, дальше
+// строки a подряд в типе dtype. Матрицы больше памяти читаются панелями
+// по несколько строк в два буфера: пока OpenMP-потоки считают панель k,
+// отдельный поток читает (pread) панель k + 1.
+
+#define MATRIX_FILE_MAGIC "TPMATRX1"
+#define MATRIX_FILE_DATA_OFFSET 4096
+#define MATRIX_FLAG_SYNTHETIC 1 // синтетическая a[i][j] = matrix_entry(i, j), можно проверить ответ
+
+typedef struct {
+    char magic[8];
+    uint32_t dtype;       // precision_t
+    uint32_t flags;
+    uint64_t cols;        // число строк a (как и везде в этом файле)
+    uint64_t rows;        // длина строки a
+    uint64_t data_offset; // смещение данных от начала файла
+} matrix_file_header_t;
+
+int write_matrix_file(const char *path, int n, precision_t prec) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    char page[MATRIX_FILE_DATA_OFFSET] = { 0 };
+    matrix_file_header_t header = { MATRIX_FILE_MAGIC, prec, MATRIX_FLAG_SYNTHETIC, n, n, MATRIX_FILE_DATA_OFFSET };
+    memcpy(page, &header, sizeof(header));
+    int ok = pwrite(fd, page, sizeof(page), 0) == (ssize_t)sizeof(page);
+
+    // пишем по панелям, чтобы не держать всю матрицу в памяти
+    size_t row_bytes = precision_sizes[prec] * (size_t)n;
+    int panel_rows = (int)((64u << 20) / row_bytes) + 1;
+    char *panel = malloc(row_bytes * panel_rows);
+    for (int p0 = 0; ok && p0 < n; p0 += panel_rows) {
+        int count = (n - p0 < panel_rows) ? n - p0 : panel_rows;
+        #pragma omp parallel for schedule(static)
+        for (int r = 0; r < count; r++) {
+            for (int j = 0; j < n; j++) {
+                size_t k = (size_t)r * n + j;
+                int i = p0 + r;
+                if (prec == PREC_FLOAT) {
+                    ((float *)panel)[k] = (float)matrix_entry(i, j);
+                }
+                else if (prec == PREC_BF16) {
+                    ((bf16_t *)panel)[k] = float_to_bf16((float)matrix_entry(i, j));
+                }
+                else {
+                    ((double *)panel)[k] = matrix_entry(i, j);
+                }
+            }
+        }
+        size_t len = row_bytes * count;
+        off_t offset = MATRIX_FILE_DATA_OFFSET + (off_t)row_bytes * p0;
+        for (size_t done = 0; ok && done < len; ) {
+            ssize_t w = pwrite(fd, panel + done, len - done, offset + done);
+            ok = w > 0;
+            done += (w > 0) ? (size_t)w : 0;
+        }
+    }
+
+    free(panel);
+    if (!ok) {
+        perror(path);
+    }
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+int read_matrix_header(int fd, const char *path, matrix_file_header_t *header) {
+    if (pread(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header) ||
+        memcmp(header->magic, MATRIX_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->dtype > PREC_BF16 || header->cols == 0 || header->rows == 0 ||
+        header->cols > INT32_MAX || header->rows > INT32_MAX) {
+        fprintf(stderr, "%s: not a matrix file\n", path);
+        return -1;
+    }
+    // данные должны целиком лежать в файле: обрезанный файл при mmap
+    // иначе дал бы SIGBUS на первой же странице за концом
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        return -1;
+    }
+    uint64_t size = (uint64_t)st.st_size;
+    uint64_t row_bytes = precision_sizes[header->dtype] * header->rows;
+    if (header->data_offset < sizeof(*header) || header->data_offset > size ||
+        header->cols > (size - header->data_offset) / row_bytes) {
+        fprintf(stderr, "%s: truncated or corrupt matrix file (%llu bytes, need %llu + %llu x %llu)\n", path,
+                (unsigned long long)size, (unsigned long long)header->data_offset,
+                (unsigned long long)header->cols, (unsigned long long)row_bytes);
+        return -1;
+    }
+    return 0;
+}
+
+// c[0..count) = panel * b, панель - count строк длины rows в типе prec
+void gemv_panel(const void *panel, precision_t prec, const double *b, double *c, int count, int rows) {
+    #pragma omp parallel
+    {
+        int lb, ub;
+        thread_range(count, &lb, &ub);
+        if (prec == PREC_FLOAT) {
+            gemv_rows_f32((const float *)panel, b, c, lb, ub, rows);
+        }
+        else if (prec == PREC_BF16) {
+            gemv_rows_bf16((const bf16_t *)panel, b, c, lb, ub, rows);
+        }
+        else {
+            gemv_rows((const double *)panel, b, c, lb, ub, rows);
+        }
+    }
+}
+
+typedef struct {
+    int fd;
+    off_t data_offset;
+    size_t row_bytes;
+    int cols, panel_rows, num_panels;
+
+    void *buf[2];
+    int count[2];  // строк в буфере; 0 - буфер свободен, -1 - ошибка чтения
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    double read_seconds;
+} panel_stream_t;
+
+static void *panel_reader(void *arg) {
+    panel_stream_t *st = arg;
+    for (int p = 0; p < st->num_panels; p++) {
+        int slot = p % 2;
+        pthread_mutex_lock(&st->mutex);
+        while (st->count[slot] != 0) {
+            pthread_cond_wait(&st->cond, &st->mutex);
+        }
+        pthread_mutex_unlock(&st->mutex);
+
+        int p0 = p * st->panel_rows;
+        int count = (st->cols - p0 < st->panel_rows) ? st->cols - p0 : st->panel_rows;
+        size_t len = st->row_bytes * count;
+        off_t offset = st->data_offset + (off_t)st->row_bytes * p0;
+
+        double t = cpuSecond();
+        size_t done = 0;
+        while (done < len) {
+            ssize_t r = pread(st->fd, (char *)st->buf[slot] + done, len - done, offset + done);
+            if (r <= 0) {
+                break;
+            }
+            done += r;
+        }
+        st->read_seconds += cpuSecond() - t;
+
+        pthread_mutex_lock(&st->mutex);
+        st->count[slot] = (done == len) ? count : -1;
+        pthread_cond_broadcast(&st->cond);
+        pthread_mutex_unlock(&st->mutex);
+        if (done != len) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+int run_matrix_file(const char *path, const char *io, int panel_mb) {
+    if (strcmp(io, "stream") != 0 && strcmp(io, "mmap") != 0) {
+        fprintf(stderr, "unknown io '%s' (stream|mmap)\n", io);
+        return -1;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    matrix_file_header_t header;
+    if (read_matrix_header(fd, path, &header) != 0) {
+        close(fd);
+        return -1;
+    }
+    int cols = (int)header.cols, rows = (int)header.rows;
+    precision_t prec = header.dtype;
+    size_t row_bytes = precision_sizes[prec] * (size_t)rows;
+    double matrix_bytes = (double)row_bytes * cols;
+
+    double *b = malloc(sizeof(*b) * rows);
+    double *c = malloc(sizeof(*c) * cols);
+    if (!b || !c) {
+        fprintf(stderr, "cannot allocate vectors for %d x %d\n", cols, rows);
+        free(b);
+        free(c);
+        close(fd);
+        return -1;
+    }
+    for (int j = 0; j < rows; j++) {
+        b[j] = j;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    printf("\n=== MATRIX FILE %s (%d x %d, %s, %s, %d threads) ===\n",
+           path, cols, rows, precision_names[prec], io, omp_get_max_threads());
+
+    double read_seconds = 0.0, compute_seconds = 0.0;
+    double wall = cpuSecond();
+    int ok = 1;
+
+    if (strcmp(io, "mmap") == 0) {
+        // страницы подгружаются по мере обращения - чтение и счёт не разделить
+        size_t map_len = header.data_offset + (size_t)matrix_bytes;
+        char *map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("mmap");
+            ok = 0;
+        }
+        else {
+            madvise(map, map_len, MADV_SEQUENTIAL);
+            double t = cpuSecond();
+            matrix_vector_product_omp_mixed(map + header.data_offset, prec, b, c, cols, rows);
+            compute_seconds = cpuSecond() - t;
+            munmap(map, map_len);
+        }
+    }
+    else {
+        panel_stream_t st;
+        memset(&st, 0, sizeof(st));
+        st.fd = fd;
+        st.data_offset = header.data_offset;
+        st.row_bytes = row_bytes;
+        st.cols = cols;
+        st.panel_rows = (int)(((size_t)panel_mb << 20) / row_bytes);
+        if (st.panel_rows < 1) {
+            st.panel_rows = 1;
+        }
+        if (st.panel_rows > cols) {
+            st.panel_rows = cols; // маленький файл - одна панель по размеру матрицы
+        }
+        st.num_panels = (cols + st.panel_rows - 1) / st.panel_rows;
+        st.buf[0] = malloc(row_bytes * st.panel_rows);
+        st.buf[1] = malloc(row_bytes * st.panel_rows);
+        if (!st.buf[0] || !st.buf[1]) {
+            fprintf(stderr, "cannot allocate 2 x %.1f MB panel buffers\n", row_bytes * (double)st.panel_rows / 1.e6);
+            free(st.buf[0]);
+            free(st.buf[1]);
+            free(b);
+            free(c);
+            close(fd);
+            return -1;
+        }
+        pthread_mutex_init(&st.mutex, NULL);
+        pthread_cond_init(&st.cond, NULL);
+
+        pthread_t reader;
+        pthread_create(&reader, NULL, panel_reader, &st);
+
+        for (int p = 0; p < st.num_panels; p++) {
+            int slot = p % 2;
+            pthread_mutex_lock(&st.mutex);
+            while (st.count[slot] == 0) {
+                pthread_cond_wait(&st.cond, &st.mutex);
+            }
+            int count = st.count[slot];
+            pthread_mutex_unlock(&st.mutex);
+            if (count < 0) {
+                fprintf(stderr, "%s: read error in panel %d\n", path, p);
+                ok = 0;
+                break;
+            }
+
+            double t = cpuSecond();
+            gemv_panel(st.buf[slot], prec, b, c + (size_t)p * st.panel_rows, count, rows);
+            compute_seconds += cpuSecond() - t;
+
+            // прочитанное больше не нужно - не вытесняем им кэш страниц
+            posix_fadvise(fd, st.data_offset + (off_t)row_bytes * p * st.panel_rows,
+                          (off_t)row_bytes * count, POSIX_FADV_DONTNEED);
+
+            pthread_mutex_lock(&st.mutex);
+            st.count[slot] = 0;
+            pthread_cond_broadcast(&st.cond);
+            pthread_mutex_unlock(&st.mutex);
+        }
+
+        pthread_join(reader, NULL);
+        read_seconds = st.read_seconds;
+        pthread_mutex_destroy(&st.mutex);
+        pthread_cond_destroy(&st.cond);
+        free(st.buf[0]);
+        free(st.buf[1]);
+        printf("Panels: %d x %d rows (%.1f MB each, double-buffered)\n",
+               st.num_panels, st.panel_rows, row_bytes * (double)st.panel_rows / 1.e6);
+    }
+    wall = cpuSecond() - wall;
+
+    if (ok) {
+        printf("Elapsed time: %.6f ms\n", wall * 1000);
+        if (read_seconds > 0.0) {
+            printf("  [disk] %.3f GB/s (%.6f ms reading)\n", matrix_bytes / read_seconds * 1.e-9, read_seconds * 1000);
+        }
+        printf("  [compute] %.3f GFLOP/s, %.3f GB/s (%.6f ms computing)\n",
+               2.0 * cols * (double)rows / compute_seconds * 1.e-9, matrix_bytes / compute_seconds * 1.e-9,
+               compute_seconds * 1000);
+        printf("  [effective] %.3f GB/s end to end", matrix_bytes / wall * 1.e-9);
+        if (read_seconds > 0.0) {
+            // 1.0 - чтение и счёт шли строго по очереди, 2.0 - идеальное перекрытие
+            printf(", overlap %.2f", (read_seconds + compute_seconds) / wall);
+        }
+        printf("\n");
+        if (header.flags & MATRIX_FLAG_SYNTHETIC) {
+            measure_relative_error(c, cols, rows);
+            print_relative_error();
+        }
+    }
+
+    free(b);
+    free(c);
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+// --calibrate: ядра STREAM и погоня за указателем на каждом числе потоков
+// из --threads - с той же привязкой (OMP_PLACES/OMP_PROC_BIND) и тем же
+// статическим разбиением с first-touch, что у ядер GEMV. Массивы
+// выделяются заново на каждое число потоков, чтобы страницы легли на
+// узлы именно этой команды. Итог - в path.
+int run_stream_calibration(const bench_config_t *bench, const char *path, int mb) {
+    const long n = (long)mb * 1024 * 1024 / sizeof(double);
+    const long lines = n / STREAM_LINE_WORDS;
+    stream_table_t table = { .count = 0 };
+
+    printf("\n=== STREAM CALIBRATION (%d MB per array) ===\n", mb);
+    stream_print_header();
+    for (int i = 0; i < bench->nthreads; i++) {
+        omp_set_num_threads(bench->threads[i]);
+        double *a = malloc(sizeof(*a) * n);
+        double *b = malloc(sizeof(*b) * n);
+        double *c = malloc(sizeof(*c) * n);
+        size_t *next = malloc(sizeof(*next) * n);
+        if (!a || !b || !c || !next) {
+            fprintf(stderr, "cannot allocate 4 x %d MB for calibration\n", mb);
+            free(a);
+            free(b);
+            free(c);
+            free(next);
+            return -1;
+        }
+
+        double best[STREAM_KERNELS] = { INFINITY, INFINITY, INFINITY, INFINITY };
+        double chase_time = 0.0;
+        size_t sink = 0;
+        int team = 1;
+        #pragma omp parallel
+        {
+            int tid = omp_get_thread_num(), nt = omp_get_num_threads();
+            long lb, ub;
+            stream_range(n, tid, nt, &lb, &ub);
+            stream_init(a, b, c, lb, ub);
+            for (int r = 0; r < STREAM_REPS; r++) {
+                for (int k = 0; k < STREAM_KERNELS; k++) {
+                    #pragma omp barrier
+                    double t = stream_now();
+                    stream_kernel(k, a, b, c, lb, ub);
+                    #pragma omp barrier
+                    #pragma omp master
+                    {
+                        t = stream_now() - t;
+                        if (r > 0 && t < best[k]) {
+                            best[k] = t;
+                        }
+                    }
+                }
+            }
+
+            // задержка: все потоки гоняются одновременно, каждый по своему куску
+            stream_range(lines, tid, nt, &lb, &ub);
+            stream_chase_build(next, lb, ub, (uint64_t)tid + 1);
+            #pragma omp barrier
+            double t = stream_now();
+            size_t p = stream_chase_run(next, lb, STREAM_CHASE_STEPS);
+            t = stream_now() - t;
+            #pragma omp atomic
+            chase_time += t;
+            #pragma omp atomic
+            sink ^= p;
+            #pragma omp master
+            team = nt;
+        }
+
+        stream_result_t row = { .threads = team };
+        for (int k = 0; k < STREAM_KERNELS; k++) {
+            row.gbs[k] = stream_bytes[k] * n / best[k] * 1.e-9;
+        }
+        row.latency_ns = chase_time / team / STREAM_CHASE_STEPS * 1.e9;
+        stream_table_add(&table, &row);
+        stream_print_row(&row);
+        if (sink == (size_t)-1) {
+            printf("\n"); // не даём выбросить погоню
+        }
+        free(a);
+        free(b);
+        free(c);
+        free(next);
+    }
+    if (stream_table_save(&table, path) != 0) {
+        return -1;
+    }
+    printf("Calibration saved to %s\n", path);
+    return 0;
+}
+
+
+
+int main(int argc, char *argv[]) {
     int threads[] = { 1, 2, 4, 7, 8, 16, 20, 40 };
+    long sizes[] = { 20000, 40000 };
+    static bench_config_t bench;
+    static bench_report_t report;
+    bench_config_init(&bench, threads, 8, sizes, 2);
+
+    // --bind spread|close|none - политика привязки потоков
+    // --precision double|float|bf16|all - тип хранения матрицы
+    // --implicit N - только тест неявной матрицы N x N
+    // --write-matrix FILE [--size N] - записать тестовую матрицу в файл (тип - --precision)
+    // --matrix-file FILE [--io stream|mmap] [--panel-mb M] - умножить матрицу из файла
+    // --threads 1,2,4 --sizes 20000,40000 --warmup W --reps R --json FILE --csv FILE - замер (bench.h)
+    // --perf - аппаратные счётчики и roofline по каждому ядру (perfcount.h)
+    // --calibrate [--stream-mb M] - замерить STREAM на --threads и сохранить в --calibration
+    // --calibration FILE - таблица калибровки (stream.h), по умолчанию stream_calibration.csv
+    const char *bind = "spread";
+    const char *precision = "double";
+    int implicit_size = 0;
+    const char *write_path = NULL, *matrix_path = NULL, *io = "stream";
+    int file_size = 20000, panel_mb = 256;
+    const char *calibration_path = "stream_calibration.csv";
+    int calibrate = 0, stream_mb = 128;
+    for (int i = 1; i < argc; i++) {
+        if (bench_parse_arg(&bench, argc, argv, &i)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            bind = argv[++i];
+        }
+        else if (strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            precision = argv[++i];
+        }
+        else if (strcmp(argv[i], "--implicit") == 0 && i + 1 < argc) {
+            implicit_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--write-matrix") == 0 && i + 1 < argc) {
+            write_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            file_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--matrix-file") == 0 && i + 1 < argc) {
+            matrix_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--io") == 0 && i + 1 < argc) {
+            io = argv[++i];
+        }
+        else if (strcmp(argv[i], "--panel-mb") == 0 && i + 1 < argc) {
+            panel_mb = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--perf") == 0) {
+            perf_enable(1);
+        }
+        else if (strcmp(argv[i], "--calibrate") == 0) {
+            calibrate = 1;
+        }
+        else if (strcmp(argv[i], "--calibration") == 0 && i + 1 < argc) {
+            calibration_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stream-mb") == 0 && i + 1 < argc) {
+            stream_mb = atoi(argv[++i]);
+        }
+    }
+    int use_prec[3];
+    for (int p = 0; p < 3; p++) {
+        use_prec[p] = strcmp(precision, "all") == 0 || strcmp(precision, precision_names[p]) == 0;
+    }
+    if (!use_prec[PREC_DOUBLE] && !use_prec[PREC_FLOAT] && !use_prec[PREC_BF16]) {
+        fprintf(stderr, "unknown precision '%s' (double|float|bf16|all)\n", precision);
+        return 1;
+    }
+    setup_omp_affinity(bind, argv);
+    load_numa_topology();
+
+    select_gemv_kernel();
+    printf("\nNUMA nodes: %d\n", num_nodes);
+
+    if (calibrate) {
+        return run_stream_calibration(&bench, calibration_path, stream_mb) == 0 ? 0 : 1;
+    }
+    if (stream_table_load(&calibration, calibration_path) == 0) {
+        printf("STREAM calibration: %s (%d thread counts)\n", calibration_path, calibration.count);
+    }
+
+    if (implicit_size > 0) {
+        run_implicit_sweep(implicit_size, &bench, &report);
+        bench_finish(&bench, &report, "task2.1-implicit");
+        return 0;
+    }
+    if (write_path) {
+        precision_t prec = PREC_DOUBLE;
+        for (int p = 0; p < 3; p++) {
+            if (strcmp(precision, precision_names[p]) == 0) {
+                prec = p;
+            }
+        }
+        return write_matrix_file(write_path, file_size, prec) == 0 ? 0 : 1;
+    }
+    if (matrix_path) {
+        return run_matrix_file(matrix_path, io, panel_mb) == 0 ? 0 : 1;
+    }
+    printf("\nBlocked kernel ISA: %s\n", gemv_rows_name);
 
     // намеренно всё запускаем последовательно - это не ошибка!
+    // каждое время - медиана bench.reps прогонов после bench.warmup прогревочных
     printf("\n=== SERIAL ===\n");
-    double serial_results[2];
-    serial_results[0] = run_serial(20000, 20000);
-    printf("20K elapsed time: %.6f ms\n", serial_results[0]);
-    serial_results[1] = run_serial(40000, 40000);
-    printf("40K elapsed time: %.6f ms\n", serial_results[1]);
+    double serial_results[BENCH_MAX_SWEEP];
+    for (int s = 0; s < bench.nsizes; s++) {
+        int size = (int)bench.sizes[s];
+        bench_stats_t st;
+        BENCH_MEASURE(&bench, st, run_serial(size, size));
+        bench_record(&report, "serial", NULL, size, 1, st);
+        serial_results[s] = st.median;
+        printf("%dK elapsed time: %.6f ms\n", size / 1000, serial_results[s]);
+        print_throughput("serial", serial_results[s], size, size, sizeof(double), 1);
+    }
 
     printf("\n=== PARALLEL ===\n");
-    for (int i = 0; i < 8; i++) {
-        omp_set_num_threads(threads[i]);
+    for (int i = 0; i < bench.nthreads; i++) {
+        omp_set_num_threads(bench.threads[i]);
         printf("Number of threads: %d\n", omp_get_max_threads());
-        double parallel_results[2];
-        parallel_results[0] = run_parallel(20000, 20000);
-        printf("20K elapsed time: %.6f ms\n", parallel_results[0]);
-        printf("20K accelerarion ratio: %.6f\n", serial_results[0] / parallel_results[0]);
-        parallel_results[1] = run_parallel(40000, 40000);
-        printf("40K elapsed time: %.6f ms\n", parallel_results[1]);
-        printf("40K accelerarion ratio: %.6f\n", serial_results[1] / parallel_results[1]);
+        for (int s = 0; s < bench.nsizes; s++) {
+            int size = (int)bench.sizes[s];
+            bench_stats_t st;
+            if (use_prec[PREC_DOUBLE]) {
+                BENCH_MEASURE(&bench, st, run_parallel(size, size, matrix_vector_product_omp));
+                bench_record(&report, "omp", "serial", size, bench.threads[i], st);
+                double parallel_result = st.median;
+                printf("%dK elapsed time: %.6f ms\n", size / 1000, parallel_result);
+                printf("%dK accelerarion ratio: %.6f\n", size / 1000, serial_results[s] / parallel_result);
+                print_throughput("omp", parallel_result, size, size, sizeof(double), bench.threads[i]);
+                print_node_bandwidth(size, sizeof(double));
+                print_relative_error();
+
+                BENCH_MEASURE(&bench, st, run_parallel(size, size, matrix_vector_product_omp_blocked));
+                bench_record(&report, "omp-blocked", "serial", size, bench.threads[i], st);
+                double blocked_result = st.median;
+                printf("%dK blocked elapsed time: %.6f ms\n", size / 1000, blocked_result);
+                printf("%dK blocked accelerarion ratio: %.6f\n", size / 1000, serial_results[s] / blocked_result);
+                print_throughput(gemv_rows_name, blocked_result, size, size, sizeof(double), bench.threads[i]);
+                print_node_bandwidth(size, sizeof(double));
+                print_relative_error();
+            }
+
+            for (int p = PREC_FLOAT; p <= PREC_BF16; p++) {
+                if (!use_prec[p]) {
+                    continue;
+                }
+                BENCH_MEASURE(&bench, st, run_parallel_mixed(size, size, p));
+                bench_record(&report, precision_names[p], "serial", size, bench.threads[i], st);
+                double mixed_result = st.median;
+                printf("%dK %s elapsed time: %.6f ms\n", size / 1000, precision_names[p], mixed_result);
+                printf("%dK %s accelerarion ratio: %.6f\n", size / 1000, precision_names[p], serial_results[s] / mixed_result);
+                print_throughput(precision_names[p], mixed_result, size, size, precision_sizes[p],
+                                 bench.threads[i]);
+                print_node_bandwidth(size, precision_sizes[p]);
+                print_relative_error();
+            }
+        }
+        print_placement_report();
         printf("------\n");
     }
 
+    bench_finish(&bench, &report, "task2.1");
     return 0;
 }
@@ -1,8 +1,14 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 #include <omp.h>
 
+#include "bench.h"
+#include "quadrature.h"
+#include "reduction.h"
+
 #define PI 3.14159265358979323846
 
 double cpuSecond() {
@@ -13,7 +19,7 @@ double cpuSecond() {
 
 
 
-double integrate(double (*func)(double), double a, double b, int nsteps) {
+double integrate_naive(double (*func)(double), double a, double b, int nsteps) {
     double h = (b - a) / nsteps;
     double sum = 0.0;
 
@@ -24,7 +30,7 @@ double integrate(double (*func)(double), double a, double b, int nsteps) {
     return sum * h;
 }
 
-double integrate_omp(double (*func)(double), double a, double b, int nsteps) {
+double integrate_omp_naive(double (*func)(double), double a, double b, int nsteps) {
     double h = (b - a) / nsteps;
     double sum = 0.0;
 
@@ -51,6 +57,59 @@ double integrate_omp(double (*func)(double), double a, double b, int nsteps) {
     return sum * h;
 }
 
+// сумма блока k из REDUCE_BLOCK шагов (последний может быть короче)
+neumaier_t integrate_block(double (*func)(double), double a, double h, int k, int nsteps) {
+    neumaier_t acc = NEUMAIER_ZERO;
+    int lb = k * REDUCE_BLOCK;
+    int ub = (nsteps - lb < REDUCE_BLOCK) ? nsteps : lb + REDUCE_BLOCK;
+    for (int i = lb; i < ub; i++) {
+        neumaier_add(&acc, func(a + h * (i + 0.5)));
+    }
+    return acc;
+}
+
+// Суммы по блокам фиксированной длины (Ноймайер) + попарное дерево из
+// Общее/reduction.h: результат побитово совпадает с integrate_omp при
+// любом числе потоков.
+double integrate(double (*func)(double), double a, double b, int nsteps) {
+    double h = (b - a) / nsteps;
+    int nblocks = reduce_blocks(nsteps, REDUCE_BLOCK);
+    neumaier_t *blocks = malloc(sizeof(neumaier_t) * nblocks);
+
+    for (int k = 0; k < nblocks; k++) {
+        blocks[k] = integrate_block(func, a, h, k, nsteps);
+    }
+
+    double sum = neumaier_result(reduce_pairwise(blocks, 0, nblocks));
+    free(blocks);
+    return sum * h;
+}
+
+double integrate_omp(double (*func)(double), double a, double b, int nsteps) {
+    double h = (b - a) / nsteps;
+    int nblocks = reduce_blocks(nsteps, REDUCE_BLOCK);
+    neumaier_t *blocks = malloc(sizeof(neumaier_t) * nblocks);
+
+    #pragma omp parallel
+    {
+        int nthreads = omp_get_num_threads();
+        int threadid = omp_get_thread_num();
+        // поток получает непрерывный кусок блоков, а не шагов: границы
+        // блоков (и значит, результат) от числа потоков не зависят
+        int lb = (int)((long long)threadid * nblocks / nthreads);
+        int ub = (int)((long long)(threadid + 1) * nblocks / nthreads);
+
+        for (int k = lb; k < ub; k++) {
+            blocks[k] = integrate_block(func, a, h, k, nsteps);
+        }
+    }
+
+    // вместо atomic - дерево в фиксированном порядке
+    double sum = neumaier_result(reduce_pairwise(blocks, 0, nblocks));
+    free(blocks);
+    return sum * h;
+}
+
 
 
 double func(double x) {
@@ -58,6 +117,85 @@ double func(double x) {
     return exp(-x * x);
 }
 
+// та же функция, но встраиваемая и с векторизуемой экспонентой
+static inline double func_inline(double x) {
+    return quad_exp(-x * x);
+}
+
+DEFINE_QUADRATURE(func_inline)
+
+// семейство для пакетного режима: p[2] * exp(-p[0] * (x - p[1])^2)
+static inline double gauss_param(double x, const double *p) {
+    double d = x - p[1];
+    return p[2] * quad_exp(-p[0] * d * d);
+}
+
+DEFINE_QUADRATURE_BATCH(gauss_param)
+
+double gauss_param_exact(const quad_job_t *job) {
+    double s = sqrt(job->params[0]);
+    return job->params[2] * sqrt(PI) / (2.0 * s) *
+           (erf(s * (job->b - job->params[1])) - erf(s * (job->a - job->params[1])));
+}
+
+// Детерминированный набор заданий: в основном мелкие (широкий колокол на
+// коротком отрезке), и каждое 500-е - крупное (пик на длинном отрезке
+// со строгим допуском), которому нужно во много раз больше вычислений.
+void make_jobs(quad_job_t *jobs, int njobs) {
+    unsigned long long state = 12345;
+    for (int k = 0; k < njobs; k++) {
+        double u[4];
+        for (int m = 0; m < 4; m++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            u[m] = (double)(state >> 11) / 9007199254740992.0; // [0, 1)
+        }
+        quad_job_t job;
+        if (k % 500 == 0) {
+            job.a = -50.0;
+            job.b = 50.0;
+            job.params[0] = 1.0 + u[0];
+            job.tol = 1.e-14;
+        }
+        else {
+            job.a = -3.0 * u[1];
+            job.b = 3.0 * u[2];
+            job.params[0] = 0.5 + 3.5 * u[0];
+            job.tol = 1.e-10;
+        }
+        job.params[1] = u[3] - 0.5;
+        job.params[2] = 1.0 + u[1];
+        job.params[3] = 0.0;
+        jobs[k] = job;
+    }
+}
+
+// per_job = 1 - как integrate_omp: своя параллельная область на каждый интеграл
+double run_batch(const quad_job_t *jobs, quad_result_t *results, int njobs, int per_job) {
+    double t = cpuSecond();
+    if (per_job) {
+        for (int k = 0; k < njobs; k++) {
+            #pragma omp parallel
+            #pragma omp single
+            results[k] = gauss_param_job_rec(jobs[k].a, jobs[k].b, jobs[k].params, jobs[k].tol, 0);
+        }
+    }
+    else {
+        gauss_param_batch(jobs, results, njobs);
+    }
+    t = cpuSecond() - t;
+
+    long long evals = 0;
+    double max_error = 0.0;
+    for (int k = 0; k < njobs; k++) {
+        evals += results[k].evals;
+        double err = fabs(results[k].value - gauss_param_exact(&jobs[k]));
+        max_error = (err > max_error) ? err : max_error;
+    }
+    printf("\n%d integrals, %lld evaluations, max error %.3e\n", njobs, evals, max_error);
+    printf("%.0f integrals/s\n", njobs / t);
+    return t * 1000; // возвращаем значение в мс
+}
+
 double run_serial(double a, double b, int nsteps) {
     double t = cpuSecond();
     double res = integrate(func, a, b, nsteps);
@@ -77,31 +215,154 @@ double run_parallel(double a, double b, int nsteps) {
 }
 
 
+// наивная сумма против компенсированной (reduction.h): время и точные биты результата
+void run_reduction_compare(double a, double b, int nsteps, double reference) {
+    double t = cpuSecond();
+    double naive = integrate_omp_naive(func, a, b, nsteps);
+    double t_naive = (cpuSecond() - t) * 1000;
+
+    t = cpuSecond();
+    double compensated = integrate_omp(func, a, b, nsteps);
+    double t_compensated = (cpuSecond() - t) * 1000;
+
+    printf("Naive:       %a (%.6f ms)\n", naive, t_naive);
+    printf("Compensated: %a (%.6f ms), bitwise equal to serial: %s\n", compensated, t_compensated,
+           compensated == reference ? "yes" : "NO");
+    printf("Compensated overhead: %.2f%%\n", 100.0 * (t_compensated - t_naive) / t_naive);
+}
+
+// mode: 0 - средние прямоугольники (SIMD), 1 - Симпсон (SIMD), 2 - адаптивный Гаусс-Кронрод
+double run_quadrature(int mode, double a, double b, int nsteps, double tol) {
+    quad_result_t res = { 0.0, 0.0, 0 };
+    double t = cpuSecond();
+    if (mode == 0) {
+        res.value = func_inline_midpoint(a, b, nsteps);
+        res.evals = nsteps;
+    }
+    else if (mode == 1) {
+        res.value = func_inline_simpson(a, b, nsteps);
+        res.evals = nsteps + 1;
+    }
+    else {
+        res = func_inline_adaptive(a, b, tol);
+    }
+    t = cpuSecond() - t;
+
+    // на [-4, 4] интеграл меньше sqrt(PI) на ~2.7e-8 (хвосты), поэтому
+    // отдельно печатаем ошибку и относительно точного sqrt(PI) * erf(4)
+    printf("\nResult: %.12f // Error: %.12f // vs erf: %.3e // %lld evaluations\n", res.value,
+           fabs(res.value - sqrt(PI)), fabs(res.value - sqrt(PI) * erf(b)), res.evals);
+    return t * 1000; // возвращаем значение в мс
+}
+
 
-int main() {
+
+int main(int argc, char *argv[]) {
     int threads[] = { 1, 2, 4, 7, 8, 16, 20, 40 };
+    long sizes[] = { 40000000, 80000000 };
+    static bench_config_t bench;
+    static bench_report_t report;
+    bench_config_init(&bench, threads, 8, sizes, 2);
+
+    // --tol T - допуск адаптивного режима (абсолютный)
+    // --batch N - число интегралов в пакетном режиме
+    // --threads 1,2,4 --sizes 40000000,80000000 --warmup W --reps R --json FILE --csv FILE - замер (bench.h)
+    double tol = 1.e-12;
+    int njobs = 10000;
+    for (int i = 1; i < argc; i++) {
+        if (bench_parse_arg(&bench, argc, argv, &i)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--tol") == 0 && i + 1 < argc) {
+            tol = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            njobs = atoi(argv[++i]);
+        }
+    }
+    // квадратуры, редукция и пакет - на наибольшем числе шагов из --sizes
+    const int nlast = bench.nsizes - 1;
+    const int nsteps = (int)bench.sizes[nlast];
 
     // намеренно всё запускаем последовательно - это не ошибка!
+    // каждое время - медиана bench.reps прогонов после bench.warmup прогревочных
     printf("\n=== SERIAL ===");
-    double serial_results[2];
-    serial_results[0] = run_serial(-4.0, 4.0, 40000000);
-    printf("40M elapsed time: %.6f ms\n", serial_results[0]);
-    serial_results[1] = run_serial(-4.0, 4.0, 80000000);
-    printf("80M elapsed time: %.6f ms\n", serial_results[1]);
+    double serial_results[BENCH_MAX_SWEEP];
+    for (int s = 0; s < bench.nsizes; s++) {
+        bench_stats_t st;
+        BENCH_MEASURE(&bench, st, run_serial(-4.0, 4.0, (int)bench.sizes[s]));
+        bench_record(&report, "serial", NULL, bench.sizes[s], 1, st);
+        serial_results[s] = st.median;
+        printf("%ldM elapsed time: %.6f ms\n", bench.sizes[s] / 1000000, serial_results[s]);
+    }
 
     printf("\n=== PARALLEL ===\n");
-    for (int i = 0; i < 8; i++) {
-        omp_set_num_threads(threads[i]);
+    for (int i = 0; i < bench.nthreads; i++) {
+        omp_set_num_threads(bench.threads[i]);
+        printf("Number of threads: %d\n", omp_get_max_threads());
+        for (int s = 0; s < bench.nsizes; s++) {
+            bench_stats_t st;
+            BENCH_MEASURE(&bench, st, run_parallel(-4.0, 4.0, (int)bench.sizes[s]));
+            bench_record(&report, "omp", "serial", bench.sizes[s], bench.threads[i], st);
+            printf("%ldM elapsed time: %.6f ms\n", bench.sizes[s] / 1000000, st.median);
+            printf("%ldM accelerarion ratio: %.6f\n", bench.sizes[s] / 1000000, serial_results[s] / st.median);
+        }
+        printf("------\n");
+    }
+
+    printf("\n=== REDUCTION (reduction.h) ===\n");
+    double reference = integrate(func, -4.0, 4.0, nsteps);
+    printf("Serial compensated: %a, naive: %a\n", reference, integrate_naive(func, -4.0, 4.0, nsteps));
+    for (int i = 0; i < bench.nthreads; i++) {
+        omp_set_num_threads(bench.threads[i]);
+        printf("Number of threads: %d\n", omp_get_max_threads());
+        run_reduction_compare(-4.0, 4.0, nsteps, reference);
+        printf("------\n");
+    }
+
+    printf("\n=== QUADRATURE (quadrature.h) ===\n");
+    const char *modes[] = { "midpoint SIMD", "Simpson SIMD", "Adaptive GK15" };
+    for (int i = 0; i < bench.nthreads; i++) {
+        omp_set_num_threads(bench.threads[i]);
+        printf("Number of threads: %d\n", omp_get_max_threads());
+        for (int m = 0; m < 3; m++) {
+            bench_stats_t st;
+            BENCH_MEASURE(&bench, st, run_quadrature(m, -4.0, 4.0, nsteps, tol));
+            bench_record(&report, modes[m], "serial", nsteps, bench.threads[i], st);
+            if (m < 2) {
+                printf("%dM ", nsteps / 1000000);
+            }
+            printf("%s elapsed time: %.6f ms\n", modes[m], st.median);
+            if (m < 2) {
+                printf("%dM ", nsteps / 1000000);
+            }
+            printf("%s accelerarion ratio: %.6f\n", modes[m], serial_results[nlast] / st.median);
+        }
+        printf("------\n");
+    }
+
+    printf("\n=== BATCH (%d integrals) ===\n", njobs);
+    quad_job_t *jobs = malloc(sizeof(quad_job_t) * njobs);
+    quad_result_t *results = malloc(sizeof(quad_result_t) * njobs);
+    make_jobs(jobs, njobs);
+    for (int i = 0; i < bench.nthreads; i++) {
+        omp_set_num_threads(bench.threads[i]);
         printf("Number of threads: %d\n", omp_get_max_threads());
-        double parallel_results[2];
-        parallel_results[0] = run_parallel(-4.0, 4.0, 40000000);
-        printf("40M elapsed time: %.6f ms\n", parallel_results[0]);
-        printf("40M accelerarion ratio: %.6f\n", serial_results[0] / parallel_results[0]);
-        parallel_results[1] = run_parallel(-4.0, 4.0, 80000000);
-        printf("80M elapsed time: %.6f ms\n", parallel_results[1]);
-        printf("80M accelerarion ratio: %.6f\n", serial_results[1] / parallel_results[1]);
+        bench_stats_t st;
+        BENCH_MEASURE(&bench, st, run_batch(jobs, results, njobs, 1));
+        bench_record(&report, "batch per-integral", NULL, njobs, bench.threads[i], st);
+        double per_job = st.median;
+        printf("Per-integral regions elapsed time: %.6f ms\n", per_job);
+        BENCH_MEASURE(&bench, st, run_batch(jobs, results, njobs, 0));
+        bench_record(&report, "batch", "batch per-integral", njobs, bench.threads[i], st);
+        double batch = st.median;
+        printf("Batch elapsed time: %.6f ms\n", batch);
+        printf("Batch accelerarion ratio: %.6f\n", per_job / batch);
         printf("------\n");
     }
+    free(jobs);
+    free(results);
 
+    bench_finish(&bench, &report, "task2.2");
     return 0;
 }
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+
+// Квадратурные формулы для integrate_omp: векторизуемые составные
+// формулы средних прямоугольников и Симпсона, и адаптивная формула
+// Гаусса-Кронрода (G7-K15), которая дробит отрезок только там, где
+// оценка ошибки больше допуска, и раздаёт половины потокам как omp task.
+//
+// Подынтегральная функция передаётся не указателем, а именем static
+// inline функции: макрос DEFINE_QUADRATURE(f) порождает f_midpoint,
+// f_simpson и f_adaptive с прямым вызовом f, так что компилятор её
+// встраивает и векторизует цикл (указатель на функцию этому мешает).
+
+typedef struct {
+    double value;
+    double error;     // оценка ошибки (для адаптивного режима)
+    long long evals;  // число вычислений подынтегральной функции
+} quad_result_t;
+
+#define QUAD_MAX_DEPTH 50  // глубже делить бессмысленно - упираемся в точность double
+#define QUAD_TASK_DEPTH 12 // ниже этой глубины подотрезки считаются без новых задач
+
+// exp(x) без вызова libm: x = n*ln2 + r, |r| <= ln2/2, exp(r) - ряд
+// Тейлора до r^13 (ошибка ~1e-17), 2^n собирается прямо в битах
+// показателя. Ветвлений нет, поэтому цикл с ним векторизуется (GCC
+// превращает ограничение x в blend только с -fno-trapping-math).
+static inline double quad_exp(double x) {
+    const double log2e = 1.4426950408889634;
+    const double ln2_hi = 6.93147180369123816490e-01;
+    const double ln2_lo = 1.90821492927058770002e-10;
+    const double round_magic = 6755399441055744.0; // 1.5 * 2^52
+
+    x = (x < -708.0) ? -708.0 : ((x > 709.0) ? 709.0 : x);
+
+    double t = x * log2e + round_magic; // округление до целого без floor
+    double n = t - round_magic;
+    double r = (x - n * ln2_hi) - n * ln2_lo;
+
+    double p = 1.0 / 6227020800.0; // 1/13!
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    union { double d; int64_t i; } bits_t = { t }, bits_magic = { round_magic }, scale;
+    scale.i = (bits_t.i - bits_magic.i + 1023) << 52; // 2^n
+    return p * scale.d;
+}
+
+// узлы и веса Кронрода (15 точек) и Гаусса (7 точек, совпадают с
+// нечётными узлами Кронрода), как в QUADPACK qk15
+static const double quad_xgk[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+};
+static const double quad_wgk[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+};
+static const double quad_wg[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+};
+
+// fx: значения в узлах c -+ half * xgk[j] парами, fx[14] - в центре
+static inline quad_result_t quad_gk15_combine(const double *fx, double half) {
+    double kronrod = quad_wgk[7] * fx[14], gauss = quad_wg[3] * fx[14];
+    for (int j = 0; j < 7; j++) {
+        kronrod += quad_wgk[j] * (fx[2 * j] + fx[2 * j + 1]);
+        if (j & 1) {
+            gauss += quad_wg[j / 2] * (fx[2 * j] + fx[2 * j + 1]);
+        }
+    }
+    quad_result_t r = { kronrod * half, fabs(kronrod - gauss) * half, 15 };
+    return r;
+}
+
+#define DEFINE_QUADRATURE(f)                                                           \
+    /* составная формула средних прямоугольников, nsteps вычислений */                \
+    static double f##_midpoint(double a, double b, int nsteps) {                      \
+        double h = (b - a) / nsteps;                                                   \
+        double sum = 0.0;                                                              \
+        _Pragma("omp parallel for simd schedule(static) reduction(+:sum)")             \
+        for (int i = 0; i < nsteps; i++) {                                             \
+            sum += f(a + h * (i + 0.5));                                               \
+        }                                                                              \
+        return sum * h;                                                                \
+    }                                                                                  \
+                                                                                       \
+    /* составная формула Симпсона, nsteps чётное, nsteps + 1 вычислений */           \
+    static double f##_simpson(double a, double b, int nsteps) {                       \
+        double h = (b - a) / nsteps;                                                   \
+        double sum = 0.0;                                                              \
+        _Pragma("omp parallel for simd schedule(static) reduction(+:sum)")             \
+        for (int i = 1; i < nsteps; i++) {                                             \
+            sum += ((i & 1) ? 4.0 : 2.0) * f(a + h * i);                               \
+        }                                                                              \
+        return (sum + f(a) + f(b)) * h / 3.0;                                          \
+    }                                                                                  \
+                                                                                       \
+    static quad_result_t f##_gk15(double a, double b) {                               \
+        double c = 0.5 * (a + b), half = 0.5 * (b - a);                                \
+        double fx[15];                                                                 \
+        _Pragma("omp simd")                                                            \
+        for (int j = 0; j < 7; j++) {                                                  \
+            fx[2 * j] = f(c - half * quad_xgk[j]);                                     \
+            fx[2 * j + 1] = f(c + half * quad_xgk[j]);                                 \
+        }                                                                              \
+        fx[14] = f(c);                                                                 \
+        return quad_gk15_combine(fx, half);                                            \
+    }                                                                                  \
+                                                                                       \
+    static quad_result_t f##_adaptive_rec(double a, double b, double tol, int depth) { \
+        quad_result_t r = f##_gk15(a, b);                                              \
+        if (r.error <= tol || depth >= QUAD_MAX_DEPTH) {                               \
+            return r;                                                                  \
+        }                                                                              \
+        double m = 0.5 * (a + b);                                                      \
+        quad_result_t left, right;                                                     \
+        /* половины - независимые задачи; допуск делится пополам */                    \
+        _Pragma("omp task shared(left) if(depth < QUAD_TASK_DEPTH)")                   \
+        left = f##_adaptive_rec(a, m, 0.5 * tol, depth + 1);                           \
+        _Pragma("omp task shared(right) if(depth < QUAD_TASK_DEPTH)")                  \
+        right = f##_adaptive_rec(m, b, 0.5 * tol, depth + 1);                          \
+        _Pragma("omp taskwait")                                                        \
+        /* складываем всегда слева направо - результат не зависит от потоков */        \
+        quad_result_t sum = { left.value + right.value, left.error + right.error,     \
+                              r.evals + left.evals + right.evals };                    \
+        return sum;                                                                    \
+    }                                                                                  \
+                                                                                       \
+    /* адаптивный Гаусс-Кронрод с абсолютным допуском tol */                          \
+    static quad_result_t f##_adaptive(double a, double b, double tol) {               \
+        quad_result_t res;                                                             \
+        _Pragma("omp parallel")                                                        \
+        _Pragma("omp single")                                                          \
+        res = f##_adaptive_rec(a, b, tol, 0);                                          \
+        return res;                                                                    \
+    }
+
+
+// Пакетный режим: тысячи интегралов f(x, params) с разными пределами,
+// параметрами и допусками за один вызов. Одна параллельная область на
+// весь пакет; задания раздаются через omp taskloop, так что свободные
+// потоки сами забирают работу (динамическая балансировка):
+//  - мелкие задания упакованы по grainsize штук в одну задачу;
+//  - крупное задание, которому понадобилось больше QUAD_SPLIT_DEPTH
+//    делений пополам, дальше дробится на вложенные задачи.
+
+#define QUAD_MAX_PARAMS 4
+#define QUAD_SPLIT_DEPTH 3   // до этой глубины задание считается одним потоком
+#define QUAD_BATCH_CHUNKS 16 // задач taskloop на поток
+
+typedef struct {
+    double a, b;
+    double params[QUAD_MAX_PARAMS];
+    double tol; // абсолютный допуск
+} quad_job_t;
+
+#define DEFINE_QUADRATURE_BATCH(f)                                                                 \
+    static quad_result_t f##_job_rec(double a, double b, const double *p, double tol, int depth) { \
+        double c = 0.5 * (a + b), half = 0.5 * (b - a);                                            \
+        double fx[15];                                                                             \
+        _Pragma("omp simd")                                                                        \
+        for (int j = 0; j < 7; j++) {                                                              \
+            fx[2 * j] = f(c - half * quad_xgk[j], p);                                              \
+            fx[2 * j + 1] = f(c + half * quad_xgk[j], p);                                          \
+        }                                                                                          \
+        fx[14] = f(c, p);                                                                          \
+        quad_result_t r = quad_gk15_combine(fx, half);                                             \
+        if (r.error <= tol || depth >= QUAD_MAX_DEPTH) {                                           \
+            return r;                                                                              \
+        }                                                                                          \
+        quad_result_t left, right;                                                                 \
+        _Pragma("omp task shared(left) if(depth >= QUAD_SPLIT_DEPTH && depth < QUAD_TASK_DEPTH)")  \
+        left = f##_job_rec(a, c, p, 0.5 * tol, depth + 1);                                         \
+        _Pragma("omp task shared(right) if(depth >= QUAD_SPLIT_DEPTH && depth < QUAD_TASK_DEPTH)") \
+        right = f##_job_rec(c, b, p, 0.5 * tol, depth + 1);                                        \
+        _Pragma("omp taskwait")                                                                    \
+        quad_result_t sum = { left.value + right.value, left.error + right.error,                  \
+                              r.evals + left.evals + right.evals };                                \
+        return sum;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    static void f##_batch(const quad_job_t *jobs, quad_result_t *results, int njobs) {             \
+        _Pragma("omp parallel")                                                                    \
+        _Pragma("omp single")                                                                      \
+        {                                                                                          \
+            int grain = njobs / (omp_get_num_threads() * QUAD_BATCH_CHUNKS);                       \
+            grain = (grain < 1) ? 1 : grain;                                                       \
+            /* taskloop ждёт и вложенные задачи (неявная taskgroup) */                             \
+            _Pragma("omp taskloop grainsize(grain)")                                               \
+            for (int k = 0; k < njobs; k++) {                                                      \
+                results[k] = f##_job_rec(jobs[k].a, jobs[k].b, jobs[k].params, jobs[k].tol, 0);    \
+            }                                                                                      \
+        }                                                                                          \
+    }
@@ -1,13 +1,54 @@
 #include <iostream>
+#include <string>
+#include <vector>
 #include <math.h>
+#include <string.h>
 #include <time.h>
 #include <omp.h>
 
+#include "solvers.hpp"
+#include "sparse.hpp"
+#include "workspace.hpp"
+#include "reduction.h"
+#include "bench.h"
+
 #define THAU 1.e-4
 #define EPSILON 1.e-7
+#define SPARSE_MAX_ITER 100000 // на случай матрицы, для которой THAU слишком велик
+#define SPARSE_SHIFT 1.0 // сдвиг диагонали генерируемого лапласиана: спектр [1, 9], число обусловленности 9
+#define KRYLOV_MAX_ITER 10000
+#define DELTA_BLOCK 64 // строк в блоке суммы delta (reduction.h), от числа потоков не зависит
 
 using namespace std;
 
+// Все выделения через new считаются, чтобы проверить, что в итерационном
+// цикле память не выделяется (см. last_hot_allocations)
+void* operator new(size_t size) {
+    allocation_count()++;
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// рабочие векторы живут между итерациями и между запусками
+solver_workspace workspace;
+long long last_hot_allocations = 0; // выделений памяти за последний замер
+int last_iterations = 0;
+
+// перебор потоков и размеров, повторы и сводка (bench.h)
+bench_config_t bench;
+bench_report_t report;
+
 double cpuSecond() {
     struct timespec ts;
     timespec_get(&ts, TIME_UTC);
@@ -19,7 +60,7 @@ double cpuSecond() {
 void prepare_values(double *a, double *b, double *x, int cols, int rows) {
     for (int i = 0; i < cols; i++) {
         for (int j = 0; j < rows; j++) {
-            a[i * rows + j] = (i == j) ? 2.0 : 1.0;
+            a[(size_t)i * rows + j] = (i == j) ? 2.0 : 1.0;
         }
         b[i] = cols + 1;
         x[i] = 0.0;
@@ -27,38 +68,64 @@ void prepare_values(double *a, double *b, double *x, int cols, int rows) {
 }
 
 
+// Слагаемое delta строки i: |r_i| / |b_i|. У плотной матрицы b_i = cols + 1,
+// но при b_i = 0 берётся абсолютная невязка - иначе inf/NaN в delta
+// обрывал бы цикл как "сошедшийся".
+inline double row_delta(double r, double bi) {
+    return (bi != 0.0) ? fabs(r) / fabs(bi) : fabs(r);
+}
+
+// Шаг метода для строк блока k: вклад блока в delta (по Ноймайеру) и
+// обновление x. Блоки фиксированы, а их суммы сводятся деревом
+// reduce_pairwise, поэтому delta - а значит и число итераций - побитово
+// одинаковы при любом числе потоков.
+neumaier_t update_block(int k, int cols, const double *prod, const double *b, double *x) {
+    neumaier_t acc = NEUMAIER_ZERO;
+    int ub = min(cols, (k + 1) * DELTA_BLOCK);
+    for (int i = k * DELTA_BLOCK; i < ub; i++) {
+        neumaier_add(&acc, row_delta(prod[i] - b[i], b[i]));
+        x[i] = x[i] - THAU * (prod[i] - b[i]);
+    }
+    return acc;
+}
+
+
 
 double run_serial(int cols, int rows) {
-    double *a = new double[cols * rows];
+    double *a = new double[(size_t)cols * rows];
     double *b = new double[cols];
     double *x = new double[cols];
     prepare_values(a, b, x, cols, rows);
+    int nblocks = reduce_blocks(cols, DELTA_BLOCK);
+    workspace.reserve(cols, 1);
+    workspace.reserve_blocks(nblocks, 1);
+    double *prod = workspace[0];
+    neumaier_t *blocks = workspace.blocks(0);
 
+    long long allocs = allocation_count();
     double t = cpuSecond();
 
     double delta = 10.0 * EPSILON;
+    int iter = 0;
     while (delta > EPSILON) {
-        double *prod = new double[cols];
-
         for (int i = 0; i < cols; i++) {
             prod[i] = 0.0;
 
             for (int j = 0; j < rows; j++) {
-                prod[i] += a[i * rows + j] * x[j];
+                prod[i] += a[(size_t)i * rows + j] * x[j];
             }
         }
 
-        delta = 0.0;
-        for (int i = 0; i < cols; i++) {
-            double diff = fabs(prod[i] - b[i]) / fabs(b[i]);
-            delta += diff;
-            x[i] = x[i] - THAU * (prod[i] - b[i]);
+        for (int k = 0; k < nblocks; k++) {
+            blocks[k] = update_block(k, cols, prod, b, x);
         }
-
-        delete[] prod;
+        delta = neumaier_result(reduce_pairwise(blocks, 0, nblocks));
+        iter++;
     }
 
     t = cpuSecond() - t;
+    last_hot_allocations = allocation_count() - allocs;
+    last_iterations = iter;
 
     delete[] a;
     delete[] b;
@@ -69,18 +136,22 @@ double run_serial(int cols, int rows) {
 double run_parallel_var1(int cols, int rows) {
     // для каждого распараллеливаемого цикла создается
     // отдельная параллельная секция #pragma omp parallel for
-    double *a = new double[cols * rows];
+    double *a = new double[(size_t)cols * rows];
     double *b = new double[cols];
     double *x = new double[cols];
     prepare_values(a, b, x, cols, rows);
+    int nblocks = reduce_blocks(cols, DELTA_BLOCK);
+    workspace.reserve(cols, 1);
+    workspace.reserve_blocks(nblocks, 1);
+    double *prod = workspace[0];
+    neumaier_t *blocks = workspace.blocks(0);
 
+    long long allocs = allocation_count();
     double t = cpuSecond();
 
     double delta = 10.0 * EPSILON;
+    int iter = 0;
     while (delta > EPSILON) {
-        double *prod = new double[cols];
-
-        delta = 0.0;
         #pragma omp parallel for schedule(static) // методом научного тыка установлено,
                                                   // что лучше всего для операций
                                                   // подходит режим распред-я "static".
@@ -88,24 +159,21 @@ double run_parallel_var1(int cols, int rows) {
             prod[i] = 0.0;
 
             for (int j = 0; j < rows; j++) {
-                prod[i] += a[i * rows + j] * x[j];
+                prod[i] += a[(size_t)i * rows + j] * x[j];
             }
         }
 
-        #pragma omp parallel for schedule(static) reduction(+:delta) // вместо atmoic-ов
-        //double localdelta = 0.0;
-        for (int i = 0; i < cols; i++) {
-            double diff = fabs(prod[i] - b[i]) / fabs(b[i]);
-            delta += diff; //localdelta += diff;
-            x[i] = x[i] - THAU * (prod[i] - b[i]);
+        #pragma omp parallel for schedule(static) // вместо reduction - блоки и дерево (reduction.h)
+        for (int k = 0; k < nblocks; k++) {
+            blocks[k] = update_block(k, cols, prod, b, x);
         }
-        //#pragma omp atomic
-        //delta += localdelta;
-
-        delete[] prod;
+        delta = neumaier_result(reduce_pairwise(blocks, 0, nblocks));
+        iter++;
     }
 
     t = cpuSecond() - t;
+    last_hot_allocations = allocation_count() - allocs;
+    last_iterations = iter;
 
     delete[] a;
     delete[] b;
@@ -116,45 +184,131 @@ double run_parallel_var1(int cols, int rows) {
 double run_parallel_var2(int cols, int rows) {
     // создается одна параллельная секция #pragma omp
     // parallel, охватывающая весь итерационный алгоритм.
-    double *a = new double[cols * rows];
+    double *a = new double[(size_t)cols * rows];
     double *b = new double[cols];
     double *x = new double[cols];
     prepare_values(a, b, x, cols, rows);
+    int nblocks = reduce_blocks(cols, DELTA_BLOCK);
+    workspace.reserve(cols, 1);
+    workspace.reserve_blocks(nblocks, 1);
+    double *prod = workspace[0]; // общий: каждый поток пишет только свои строки
+    neumaier_t *blocks = workspace.blocks(0);
 
+    long long allocs = allocation_count();
     double t = cpuSecond();
     double delta = 10.0 * EPSILON;
+    int iter = 0;
 
+    const int region = PERF_REGION("var2");
     #pragma omp parallel
     {
-        double *prod = new double[cols];
-        
+        PERF_BEGIN(region);
         while (delta > EPSILON) {
 
-            delta = 0.0;
             #pragma omp for schedule(static)
             for (int i = 0; i < cols; i++) {
                 prod[i] = 0.0;
 
                 for (int j = 0; j < rows; j++) {
-                    prod[i] += a[i * rows + j] * x[j];
+                    prod[i] += a[(size_t)i * rows + j] * x[j];
                 }
             }
 
-            #pragma omp for schedule(static) reduction(+:delta) // вместо atmoic-ов
-            //double localdelta = 0.0;
-            for (int i = 0; i < cols; i++) {
-                double diff = fabs(prod[i] - b[i]) / fabs(b[i]);
-                delta += diff; //localdelta += diff;
-                x[i] = x[i] - THAU * (prod[i] - b[i]);
+            #pragma omp for schedule(static) // вместо reduction - блоки и дерево (reduction.h)
+            for (int k = 0; k < nblocks; k++) {
+                blocks[k] = update_block(k, cols, prod, b, x);
+            }
+
+            // delta пишется после барьеров обоих omp for, когда все потоки
+            // уже проверили условие цикла; барьер single - до новой проверки
+            #pragma omp single
+            {
+                delta = neumaier_result(reduce_pairwise(blocks, 0, nblocks));
+                iter++;
             }
-            //#pragma omp atomic
-            //delta += localdelta;
         }
+        PERF_END(region);
+    }
+
+    t = cpuSecond() - t;
+    last_hot_allocations = allocation_count() - allocs;
+    last_iterations = iter;
+
+    delete[] a;
+    delete[] b;
+    delete[] x;
+    return t * 1000; // возвращаем значение в мс
+}
 
-        delete[] prod;
+
+
+double run_parallel_var3(int cols, int rows) {
+    // одна параллельная секция, как в var2, но произведение, невязка и
+    // обновление x считаются за один проход по строке. x хранится в двух
+    // буферах: итерация читает x_cur и пишет x_next, поэтому обновлять
+    // "на месте" безопасно, а барьер на итерацию нужен ровно один.
+    double *a = new double[(size_t)cols * rows];
+    double *b = new double[cols];
+    double *x = new double[cols];
+    prepare_values(a, b, x, cols, rows);
+    int nblocks = reduce_blocks(cols, DELTA_BLOCK);
+    workspace.reserve(cols, 2);
+    workspace.reserve_blocks(nblocks, 2);
+    double *xbuf[2] = { workspace[0], workspace[1] };
+    neumaier_t *blocks[2] = { workspace.blocks(0), workspace.blocks(1) };
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < cols; i++) {
+        xbuf[0][i] = x[i];
+    }
+
+    long long allocs = allocation_count();
+    double t = cpuSecond();
+    int iter = 0;
+
+    const int region = PERF_REGION("var3");
+    #pragma omp parallel
+    {
+        PERF_BEGIN(region);
+        for (int it = 0;; it++) {
+            const double *x_cur = xbuf[it & 1];
+            double *x_next = xbuf[(it + 1) & 1];
+            neumaier_t *sums = blocks[it & 1];
+
+            #pragma omp for schedule(static) nowait
+            for (int k = 0; k < nblocks; k++) {
+                neumaier_t acc = NEUMAIER_ZERO;
+                int ub = min(cols, (k + 1) * DELTA_BLOCK);
+                for (int i = k * DELTA_BLOCK; i < ub; i++) {
+                    double sum = 0.0;
+                    for (int j = 0; j < rows; j++) {
+                        sum += a[(size_t)i * rows + j] * x_cur[j];
+                    }
+                    neumaier_add(&acc, row_delta(sum - b[i], b[i]));
+                    x_next[i] = x_cur[i] - THAU * (sum - b[i]);
+                }
+                sums[k] = acc;
+            }
+
+            // суммы блоков чередуются по чётности итерации: массив
+            // итерации it перезапишется только на it + 2, т.е. после
+            // следующего барьера, когда все его уже прочитали
+            #pragma omp barrier
+
+            // дерево не меняет массив, все потоки сводят его одинаково
+            double delta = neumaier_result(reduce_pairwise(sums, 0, nblocks));
+            if (delta <= EPSILON) {
+                #pragma omp master
+                iter = it + 1;
+                break;
+            }
+        }
+        PERF_END(region);
     }
 
     t = cpuSecond() - t;
+    last_hot_allocations = allocation_count() - allocs;
+    last_iterations = iter;
 
     delete[] a;
     delete[] b;
@@ -164,39 +318,350 @@ double run_parallel_var2(int cols, int rows) {
 
 
 
-int main() {
-    int threads[] = { 1, 2, 4, 7, 8, 16, 20, 40, 60, 80 };
-    int SIZE = 14400; // ~30 секунд в последовательном режиме
+inline void spmv(const csr_matrix& A, const double *x, double *y) {
+    spmv_csr(A, x, y);
+}
 
-    // намеренно всё запускаем последовательно - это не ошибка!
-    printf("\n=== SERIAL ===");
-    double serial_results;
-    serial_results = run_serial(SIZE, SIZE);
-    printf("\nElapsed time: %.6f ms\n", serial_results);
-
-    printf("\n=== PARALLEL ===\n");
-    for (int i = 0; i < 10; i++) {
-        omp_set_num_threads(threads[i]);
+inline void spmv(const sell_matrix& A, const double *x, double *y) {
+    spmv_sell(A, x, y);
+}
+
+// Тот же метод простой итерации (шаг thau, EPSILON), но с разреженной
+// матрицей: O(nnz) памяти и работы на итерацию вместо O(n^2). Матрица
+// может прийти из файла, где b = A * 1 содержит нули (строки лапласиана
+// в сумме дают 0), поэтому критерий - относительная невязка по норме
+// ||Ax - b|| / ||b||, а не сумма |r_i| / |b_i|. *converged = false, если
+// за SPARSE_MAX_ITER не сошлось или невязка стала inf/NaN.
+template <class Matrix>
+double run_sparse(const Matrix& A, const double *b, int n, double thau, int *iterations, bool *converged) {
+    workspace.reserve(n, 2); // first-touch тем же разбиением, что и в обновлении
+    double *x = workspace[0], *prod = workspace[1];
+
+    double bb = 0.0;
+    #pragma omp parallel for schedule(static) reduction(+:bb)
+    for (int i = 0; i < n; i++) {
+        x[i] = 0.0;
+        bb += b[i] * b[i];
+    }
+    double b_norm = (bb > 0.0) ? sqrt(bb) : 1.0; // b = 0 - абсолютная невязка
+
+    long long allocs = allocation_count();
+    double t = cpuSecond();
+
+    double delta = 10.0 * EPSILON;
+    int iter = 0;
+    while (delta > EPSILON && iter < SPARSE_MAX_ITER) {
+        double rr = 0.0;
+        #pragma omp parallel
+        {
+            spmv(A, x, prod); // строки поделены по числу ненулевых элементов
+            #pragma omp barrier
+
+            #pragma omp for schedule(static) reduction(+:rr)
+            for (int i = 0; i < n; i++) {
+                double r = prod[i] - b[i];
+                rr += r * r;
+                x[i] = x[i] - thau * r;
+            }
+        }
+        delta = sqrt(rr) / b_norm; // NaN тоже выходит из цикла - и не считается сходимостью
+        iter++;
+    }
+
+    t = cpuSecond() - t;
+    last_hot_allocations = allocation_count() - allocs;
+    *iterations = iter;
+    *converged = delta <= EPSILON;
+    return t * 1000; // возвращаем значение в мс
+}
+
+// --perf: счётчики и roofline участка name (perfcount.h) за прогон
+// плотной итерации: на итерацию 2 * cols * rows операций произведения,
+// матрица читается целиком
+void print_dense_perf(const char *name, int cols, int rows, double ms) {
+    double work = (double)last_iterations * cols * rows;
+    perf_print_region(PERF_REGION(name), 2.0 * work, sizeof(double) * work, ms);
+}
+
+void run_sparse_sweep(const csr_matrix& A, double thau, const string& format) {
+    int n = A.n_rows;
+    // правая часть b = A * 1, так что точное решение - вектор из единиц
+    vector<double> ones(n, 1.0), b(n);
+    #pragma omp parallel num_threads(1)
+    spmv_csr(A, ones.data(), b.data());
+
+    sell_matrix S;
+    if (format != "csr") {
+        S = build_sell(A, 256);
+        printf("SELL-%d-%d: %.2f%% padding\n", SELL_C, S.sigma,
+               100.0 * (S.chunk_ptr[S.n_chunks] - A.nnz()) / S.chunk_ptr[S.n_chunks]);
+    }
+
+    double base[2] = { 0.0, 0.0 };
+    for (int i = 0; i < bench.nthreads; i++) {
+        omp_set_num_threads(bench.threads[i]);
         printf("Number of threads: %d\n", omp_get_max_threads());
 
-        double parallel_var1_results;
-        parallel_var1_results = run_parallel_var1(SIZE, SIZE);
-        printf("\nVar1 elapsed time: %.6f ms\n", parallel_var1_results);
-        printf("Var1 accelerarion ratio: %.6f\n", serial_results / parallel_var1_results);
+        for (int f = 0; f < 2; f++) {
+            const char *name = (f == 0) ? "CSR" : "SELL";
+            if (format != "all" && format != (f == 0 ? "csr" : "sell")) {
+                continue;
+            }
+            int iterations;
+            bool converged;
+            bench_stats_t st;
+            BENCH_MEASURE(&bench, st, (f == 0) ? run_sparse(A, b.data(), n, thau, &iterations, &converged)
+                                               : run_sparse(S, b.data(), n, thau, &iterations, &converged));
+            bench_record(&report, name, NULL, n, bench.threads[i], st);
+            double result = st.median;
+            if (i == 0) {
+                base[f] = result;
+            }
+            printf("%s elapsed time: %.6f ms (%d iterations%s)\n", name, result, iterations,
+                   converged ? "" : ", NOT converged");
+            printf("%s accelerarion ratio: %.6f\n", name, base[f] / result);
+            printf("  [%s] %.3f GFLOP/s\n", name, 2.0 * A.nnz() * iterations / (result * 1.e6));
+            printf("  [%s] allocations in hot loop: %lld\n", name, last_hot_allocations);
+        }
+        printf("------\n");
+    }
+}
+
+
+
+// === Сравнение решателей (solvers.hpp) на одном и том же операторе ===
 
-        double parallel_var2_results;
-        parallel_var2_results = run_parallel_var2(SIZE, SIZE);
-        printf("\nVar2 elapsed time: %.6f ms\n", parallel_var2_results);
-        printf("Var2 accelerarion ratio: %.6f\n", serial_results / parallel_var2_results);
+// y = A * x для плотной матрицы, вызывается внутри параллельной области
+struct dense_op {
+    const double *a;
+    int n;
 
-        if (parallel_var1_results > parallel_var2_results) {
-            printf("\nVar2 is faster on %.6f ms\n", parallel_var1_results - parallel_var2_results);
+    void operator()(const double *x, double *y) const {
+        #pragma omp for schedule(static) // неявный барьер в конце
+        for (int i = 0; i < n; i++) {
+            double sum = 0.0;
+            for (int j = 0; j < n; j++) {
+                sum += a[(size_t)i * n + j] * x[j];
+            }
+            y[i] = sum;
         }
-        else {
-            printf("\nVar1 is faster on %.6f ms\n", parallel_var2_results - parallel_var1_results);
+    }
+};
+
+template <class Matrix>
+struct sparse_op {
+    const Matrix& A;
+
+    void operator()(const double *x, double *y) const {
+        spmv(A, x, y);
+        #pragma omp barrier
+    }
+};
+
+void print_history(const vector<double>& history) {
+    // первые итерации, дальше с шагом x2 и последняя
+    vector<size_t> shown;
+    for (size_t k = 1; k < history.size(); k = (k < 4) ? k + 1 : k * 2) {
+        shown.push_back(k);
+    }
+    if (!history.empty()) {
+        shown.push_back(history.size());
+    }
+    printf("  residual history:");
+    for (size_t m = 0; m < shown.size(); m++) {
+        bool gap = m > 0 && shown[m] - shown[m - 1] > 1 && m == shown.size() - 1;
+        printf("%s [%zu] %.3e", gap ? " ..." : "", shown[m], history[shown[m] - 1]);
+    }
+    printf("\n");
+}
+
+template <class Op>
+void run_solver_sweep(Op op, const double *b, int n, double thau, const string& solver) {
+    const char *names[] = { "richardson", "cg", "bicgstab" };
+    for (int i = 0; i < bench.nthreads; i++) {
+        omp_set_num_threads(bench.threads[i]);
+        printf("Number of threads: %d\n", omp_get_max_threads());
+
+        for (int m = 0; m < 3; m++) {
+            if (solver != "all" && solver != names[m]) {
+                continue;
+            }
+            solve_result res;
+            auto solve = [&]() {
+                vector<double> x(n, 0.0);
+                if (m == 0) {
+                    res = solve_richardson(op, b, x.data(), n, thau, EPSILON, SPARSE_MAX_ITER, workspace);
+                }
+                else if (m == 1) {
+                    res = solve_cg(op, b, x.data(), n, EPSILON, KRYLOV_MAX_ITER, workspace);
+                }
+                else {
+                    res = solve_bicgstab(op, b, x.data(), n, EPSILON, KRYLOV_MAX_ITER, workspace);
+                }
+                return res.ms;
+            };
+            bench_stats_t st;
+            BENCH_MEASURE(&bench, st, solve());
+            bench_record(&report, names[m], NULL, n, bench.threads[i], st);
+            printf("%s time-to-solution: %.6f ms, %d iterations%s\n", names[m], st.median, res.iterations,
+                   res.converged ? "" : " (NOT converged)");
+            print_history(res.history);
+            printf("  allocations during solve: %lld\n", res.hot_allocations);
+            perf_print_region(PERF_REGION(names[m]), 0.0, 0.0, 0.0); // работа op не известна - без roofline
         }
         printf("------\n");
     }
+}
+
+
+
+int main(int argc, char *argv[]) {
+    int threads[] = { 1, 2, 4, 7, 8, 16, 20, 40, 60, 80 };
+    long sizes[] = { 14400 }; // ~30 секунд в последовательном режиме
+    bench_config_init(&bench, threads, 10, sizes, 1);
+
+    // --sparse N - разреженная система (сдвинутый лапласиан, ~N неизвестных)
+    // --mtx FILE - разреженная матрица из файла Matrix Market
+    // --format csr|sell|all - формат хранения для разреженного режима
+    // --solver richardson|cg|bicgstab|all - сравнить решатели (solvers.hpp)
+    // --threads 1,2,4 --sizes 14400 --warmup W --reps R --json FILE --csv FILE - замер (bench.h)
+    // --perf - аппаратные счётчики и roofline (perfcount.h)
+    int sparse_size = 0;
+    string mtx_path, format = "all", solver;
+    for (int i = 1; i < argc; i++) {
+        if (bench_parse_arg(&bench, argc, argv, &i)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--sparse") == 0 && i + 1 < argc) {
+            sparse_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--mtx") == 0 && i + 1 < argc) {
+            mtx_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        }
+        else if (strcmp(argv[i], "--solver") == 0 && i + 1 < argc) {
+            solver = argv[++i];
+        }
+        else if (strcmp(argv[i], "--perf") == 0) {
+            perf_enable(1);
+        }
+    }
+
+    if (sparse_size > 0 || !mtx_path.empty()) {
+        csr_matrix A;
+        double thau = THAU; // спектр матрицы из файла неизвестен
+        try {
+            if (!mtx_path.empty()) {
+                A = load_matrix_market(mtx_path);
+            }
+            else {
+                int g = (int)sqrt((double)sparse_size);
+                A = generate_shifted_laplacian(g, SPARSE_SHIFT);
+                thau = 2.0 / (2.0 * SPARSE_SHIFT + 8.0); // оптимальный шаг для спектра [shift, shift + 8]
+            }
+        }
+        catch (const exception& e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+        if (A.n_rows != A.n_cols) {
+            cerr << "Matrix must be square\n";
+            return 1;
+        }
+        printf("\n=== SPARSE (%d unknowns, %lld non-zeros) ===\n", A.n_rows, A.nnz());
+        if (!solver.empty()) {
+            vector<double> ones(A.n_rows, 1.0), b(A.n_rows);
+            #pragma omp parallel num_threads(1)
+            spmv_csr(A, ones.data(), b.data());
+            run_solver_sweep(sparse_op<csr_matrix>{ A }, b.data(), A.n_rows, thau, solver);
+        }
+        else {
+            run_sparse_sweep(A, thau, format);
+        }
+        bench_finish(&bench, &report, "task2.3-sparse");
+        return 0;
+    }
+
+    if (!solver.empty()) {
+        for (int s = 0; s < bench.nsizes; s++) {
+            int SIZE = (int)bench.sizes[s];
+            double *a = new double[(size_t)SIZE * SIZE];
+            double *b = new double[SIZE];
+            double *x = new double[SIZE];
+            prepare_values(a, b, x, SIZE, SIZE);
+            printf("\n=== SOLVERS (dense %d x %d) ===\n", SIZE, SIZE);
+            run_solver_sweep(dense_op{ a, SIZE }, b, SIZE, THAU, solver);
+            delete[] a;
+            delete[] b;
+            delete[] x;
+        }
+        bench_finish(&bench, &report, "task2.3-solvers");
+        return 0;
+    }
+
+    // намеренно всё запускаем последовательно - это не ошибка!
+    // каждое время - медиана bench.reps прогонов после bench.warmup прогревочных
+    for (int s = 0; s < bench.nsizes; s++) {
+        int SIZE = (int)bench.sizes[s];
+        bench_stats_t st;
+        printf("\n=== SERIAL ===");
+        double serial_results;
+        BENCH_MEASURE(&bench, st, run_serial(SIZE, SIZE));
+        bench_record(&report, "serial", NULL, SIZE, 1, st);
+        serial_results = st.median;
+        printf("\nElapsed time: %.6f ms\n", serial_results);
+        printf("Iterations: %d\n", last_iterations);
+        printf("Allocations in hot loop: %lld\n", last_hot_allocations);
+
+        printf("\n=== PARALLEL ===\n");
+        for (int i = 0; i < bench.nthreads; i++) {
+            omp_set_num_threads(bench.threads[i]);
+            printf("Number of threads: %d\n", omp_get_max_threads());
+
+            double parallel_var1_results;
+            BENCH_MEASURE(&bench, st, run_parallel_var1(SIZE, SIZE));
+            bench_record(&report, "var1", "serial", SIZE, bench.threads[i], st);
+            parallel_var1_results = st.median;
+            printf("\nVar1 elapsed time: %.6f ms\n", parallel_var1_results);
+            printf("Var1 accelerarion ratio: %.6f\n", serial_results / parallel_var1_results);
+            printf("Var1 allocations in hot loop: %lld\n", last_hot_allocations);
+            printf("Var1 iterations: %d\n", last_iterations);
+
+            double parallel_var2_results;
+            BENCH_MEASURE(&bench, st, run_parallel_var2(SIZE, SIZE));
+            bench_record(&report, "var2", "serial", SIZE, bench.threads[i], st);
+            parallel_var2_results = st.median;
+            printf("\nVar2 elapsed time: %.6f ms\n", parallel_var2_results);
+            printf("Var2 accelerarion ratio: %.6f\n", serial_results / parallel_var2_results);
+            printf("Var2 allocations in hot loop: %lld\n", last_hot_allocations);
+            printf("Var2 iterations: %d\n", last_iterations);
+            print_dense_perf("var2", SIZE, SIZE, parallel_var2_results);
+
+            if (parallel_var1_results > parallel_var2_results) {
+                printf("\nVar2 is faster on %.6f ms\n", parallel_var1_results - parallel_var2_results);
+            }
+            else {
+                printf("\nVar1 is faster on %.6f ms\n", parallel_var2_results - parallel_var1_results);
+            }
+
+            // var3: произведение, невязка и обновление x за один проход, один барьер на итерацию
+            double parallel_var3_results;
+            BENCH_MEASURE(&bench, st, run_parallel_var3(SIZE, SIZE));
+            bench_record(&report, "var3", "serial", SIZE, bench.threads[i], st);
+            parallel_var3_results = st.median;
+            printf("\nVar3 (fused) elapsed time: %.6f ms\n", parallel_var3_results);
+            printf("Var3 (fused) accelerarion ratio: %.6f\n", serial_results / parallel_var3_results);
+            printf("Var3 (fused) allocations in hot loop: %lld\n", last_hot_allocations);
+            printf("Var3 (fused) iterations: %d\n", last_iterations);
+            print_dense_perf("var3", SIZE, SIZE, parallel_var3_results);
+            printf("Var3 vs Var1: %.6f, vs Var2: %.6f\n", parallel_var1_results / parallel_var3_results,
+                   parallel_var2_results / parallel_var3_results);
+            printf("------\n");
+        }
+    }
 
+    bench_finish(&bench, &report, "task2.3");
     return 0;
 }
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <math.h>
+#include <vector>
+#include <omp.h>
+
+#include "workspace.hpp"
+#include "perfcount.h"
+
+// Итерационные решатели Ax = b: простая итерация с постоянным шагом
+// (как в run_parallel_var2), метод сопряжённых градиентов (CG, для
+// симметричных положительно определённых A) и BiCGStab (для любых A).
+//
+// Каждый решатель работает внутри одной параллельной области, как var2.
+// Оператор op(x, y) вычисляет y = A * x; его вызывают все потоки области,
+// и к выходу из него весь y должен быть записан (т.е. op заканчивается
+// барьером - неявным у omp for или явным).
+//
+// Критерий остановки у всех один и тот же - относительная невязка
+// delta = ||r||_2 / ||b||_2 <= eps, где r = b - A x (у Крылова -
+// рекуррентная невязка); при b = 0 - абсолютная ||r||_2. inf/NaN в delta
+// останавливает решение, и оно считается не сошедшимся.
+//
+// Все рабочие векторы берутся из solver_workspace, так что внутри
+// решения нет ни одного выделения памяти (см. hot_allocations).
+//
+// Параллельная область каждого решателя - участок perfcount.h с его
+// именем (--perf).
+
+struct solve_result {
+    int iterations = 0;
+    double ms = 0.0;
+    bool converged = false;
+    std::vector<double> history; // ||r|| / ||b|| после каждой итерации
+    long long hot_allocations = 0; // выделений памяти за время решения
+};
+
+const int REDUCE_STRIDE = solver_workspace::PARTIAL_STRIDE;
+
+// начало решения: память под историю - заранее, вне цикла
+inline void solve_begin(solve_result& res, int maxit, long long& allocs, double& t) {
+    res.history.reserve(maxit);
+    allocs = allocation_count();
+    t = omp_get_wtime();
+}
+
+inline void solve_end(solve_result& res, long long allocs, double t) {
+    res.ms = (omp_get_wtime() - t) * 1000;
+    res.hot_allocations = allocation_count() - allocs;
+}
+
+// Сумма k значений по всем потокам внутри параллельной области. Потоки
+// складываются всегда в одном порядке, поэтому все получают одинаковый
+// (и воспроизводимый) результат и одинаково принимают решения о ветвлении.
+inline void team_sum(double *vals, int k, double *partial) {
+    int tid = omp_get_thread_num(), nthreads = omp_get_num_threads();
+    for (int m = 0; m < k; m++) {
+        partial[tid * REDUCE_STRIDE + m] = vals[m];
+    }
+    #pragma omp barrier
+    for (int m = 0; m < k; m++) {
+        double sum = 0.0;
+        for (int t = 0; t < nthreads; t++) {
+            sum += partial[t * REDUCE_STRIDE + m];
+        }
+        vals[m] = sum;
+    }
+    #pragma omp barrier // partial можно переиспользовать
+}
+
+// ||b||_2 внутри параллельной области (одно значение во всех потоках);
+// 1 при b = 0, чтобы delta стала абсолютной невязкой
+inline double team_norm(const double *b, int n, double *partial) {
+    double bb = 0.0;
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n; i++) {
+        bb += b[i] * b[i];
+    }
+    team_sum(&bb, 1, partial);
+    return (bb > 0.0) ? sqrt(bb) : 1.0;
+}
+
+// итерация it закончилась с невязкой delta: история и решение мастера
+inline bool solve_step(solve_result& res, int it, double delta, double eps) {
+    #pragma omp master
+    {
+        res.history.push_back(delta);
+        res.iterations = it + 1;
+        res.converged = delta <= eps;
+    }
+    return delta <= eps || !std::isfinite(delta);
+}
+
+template <class Op>
+solve_result solve_richardson(Op op, const double *b, double *x, int n, double thau, double eps, int maxit,
+                              solver_workspace& ws) {
+    solve_result res;
+    ws.reserve(n, 1);
+    double *prod = ws[0], *partial = ws.partials();
+    long long allocs;
+    double t;
+    solve_begin(res, maxit, allocs, t);
+    const int region = PERF_REGION("richardson");
+
+    #pragma omp parallel
+    {
+        PERF_BEGIN(region);
+        const double b_norm = team_norm(b, n, partial);
+        for (int it = 0; it < maxit; it++) {
+            op(x, prod);
+
+            double rr = 0.0;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                rr += (prod[i] - b[i]) * (prod[i] - b[i]);
+                x[i] = x[i] - thau * (prod[i] - b[i]);
+            }
+            team_sum(&rr, 1, partial);
+
+            if (solve_step(res, it, sqrt(rr) / b_norm, eps)) {
+                break;
+            }
+        }
+        PERF_END(region);
+    }
+
+    solve_end(res, allocs, t);
+    return res;
+}
+
+template <class Op>
+solve_result solve_cg(Op op, const double *b, double *x, int n, double eps, int maxit, solver_workspace& ws) {
+    solve_result res;
+    ws.reserve(n, 3);
+    double *r = ws[0], *p = ws[1], *q = ws[2], *partial = ws.partials();
+    long long allocs;
+    double t;
+    solve_begin(res, maxit, allocs, t);
+    const int region = PERF_REGION("cg");
+
+    #pragma omp parallel
+    {
+        PERF_BEGIN(region);
+        double loc[1];
+        const double b_norm = team_norm(b, n, partial);
+
+        // r = b - A x, p = r
+        op(x, q);
+        loc[0] = 0.0;
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            r[i] = b[i] - q[i];
+            p[i] = r[i];
+            loc[0] += r[i] * r[i];
+        }
+        team_sum(loc, 1, partial);
+        double rr = loc[0];
+
+        for (int it = 0; it < maxit; it++) {
+            op(p, q);
+
+            loc[0] = 0.0;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                loc[0] += p[i] * q[i];
+            }
+            team_sum(loc, 1, partial);
+            if (loc[0] == 0.0) {
+                break; // вырождение: A не положительно определена
+            }
+            double alpha = rr / loc[0];
+
+            loc[0] = 0.0;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+                loc[0] += r[i] * r[i];
+            }
+            team_sum(loc, 1, partial);
+
+            if (solve_step(res, it, sqrt(loc[0]) / b_norm, eps)) {
+                break;
+            }
+
+            double beta = loc[0] / rr;
+            rr = loc[0];
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                p[i] = r[i] + beta * p[i];
+            }
+        }
+        PERF_END(region);
+    }
+
+    solve_end(res, allocs, t);
+    return res;
+}
+
+template <class Op>
+solve_result solve_bicgstab(Op op, const double *b, double *x, int n, double eps, int maxit,
+                            solver_workspace& ws) {
+    solve_result res;
+    ws.reserve(n, 6);
+    double *r = ws[0], *r0 = ws[1], *p = ws[2], *v = ws[3], *s = ws[4], *tv = ws[5];
+    double *partial = ws.partials();
+    long long allocs;
+    double t;
+    solve_begin(res, maxit, allocs, t);
+    const int region = PERF_REGION("bicgstab");
+
+    #pragma omp parallel
+    {
+        PERF_BEGIN(region);
+        double loc[2];
+        const double b_norm = team_norm(b, n, partial);
+
+        op(x, tv);
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            r[i] = b[i] - tv[i];
+            r0[i] = r[i];
+            p[i] = 0.0; // векторы из workspace могут хранить прошлое решение
+            v[i] = 0.0;
+        }
+
+        double rho = 1.0, alpha = 1.0, omega = 1.0;
+        for (int it = 0; it < maxit; it++) {
+            loc[0] = 0.0;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                loc[0] += r0[i] * r[i];
+            }
+            team_sum(loc, 1, partial);
+            double rho_new = loc[0];
+            if (rho_new == 0.0 || omega == 0.0) {
+                break; // вырождение метода
+            }
+            double beta = (rho_new / rho) * (alpha / omega);
+            rho = rho_new;
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                p[i] = r[i] + beta * (p[i] - omega * v[i]);
+            }
+            op(p, v);
+
+            loc[0] = 0.0;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                loc[0] += r0[i] * v[i];
+            }
+            team_sum(loc, 1, partial);
+            if (loc[0] == 0.0) {
+                break;
+            }
+            alpha = rho / loc[0];
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                s[i] = r[i] - alpha * v[i];
+            }
+            op(s, tv);
+
+            loc[0] = loc[1] = 0.0;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                loc[0] += tv[i] * s[i];
+                loc[1] += tv[i] * tv[i];
+            }
+            team_sum(loc, 2, partial);
+            omega = (loc[1] != 0.0) ? loc[0] / loc[1] : 0.0;
+
+            loc[0] = 0.0;
+            #pragma omp for schedule(static)
+            for (int i = 0; i < n; i++) {
+                x[i] += alpha * p[i] + omega * s[i];
+                r[i] = s[i] - omega * tv[i];
+                loc[0] += r[i] * r[i];
+            }
+            team_sum(loc, 1, partial);
+
+            if (solve_step(res, it, sqrt(loc[0]) / b_norm, eps)) {
+                break;
+            }
+        }
+        PERF_END(region);
+    }
+
+    solve_end(res, allocs, t);
+    return res;
+}
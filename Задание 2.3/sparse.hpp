@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+// Разреженные матрицы для метода простой итерации: CSR и SELL-C-sigma.
+// Плотная матрица 14400x14400 - это 1.6 ГБ, а у реальных систем
+// ненулевых элементов меньше 1%, поэтому храним только их.
+
+struct csr_matrix {
+    int n_rows = 0, n_cols = 0;
+    std::vector<int> row_ptr; // начало строки i в col_idx/values, размер n_rows + 1
+    std::vector<int> col_idx;
+    std::vector<double> values;
+
+    long long nnz() const {
+        return row_ptr.empty() ? 0 : row_ptr[n_rows];
+    }
+};
+
+// SELL-C-sigma: строки сортируются по длине внутри окон по sigma строк,
+// режутся на чанки по C строк, и каждый чанк хранится по столбцам с
+// дополнением до самой длинной строки чанка. Внутренний цикл идёт по C
+// соседним строкам сразу и хорошо векторизуется.
+const int SELL_C = 8;
+
+struct sell_matrix {
+    int n_rows = 0, n_chunks = 0, sigma = 0;
+    std::vector<int> chunk_ptr; // начало чанка в col/val, размер n_chunks + 1
+    std::vector<int> chunk_len; // длина самой длинной строки чанка
+    std::vector<int> perm;      // строка в SELL -> исходная строка (-1 - дополнение)
+    std::vector<int> col;
+    std::vector<double> val;
+};
+
+// [lb, ub) строк (или чанков) с примерно равным числом ненулевых
+// элементов у каждого потока, а не с равным числом строк
+inline void nnz_balanced_range(const std::vector<int>& ptr, int n, int tid, int nthreads, int& lb, int& ub) {
+    auto bound = [&](int t) {
+        if (t <= 0) {
+            return 0;
+        }
+        if (t >= nthreads) {
+            return n;
+        }
+        long long target = (long long)ptr[n] * t / nthreads;
+        return (int)(std::lower_bound(ptr.begin(), ptr.begin() + n + 1, target) - ptr.begin());
+    };
+    lb = bound(tid);
+    ub = std::max(lb, bound(tid + 1));
+}
+
+// y = A * x, вызывается всеми потоками внутри #pragma omp parallel
+inline void spmv_csr(const csr_matrix& A, const double *x, double *y) {
+    int lb, ub;
+    nnz_balanced_range(A.row_ptr, A.n_rows, omp_get_thread_num(), omp_get_num_threads(), lb, ub);
+    for (int i = lb; i < ub; i++) {
+        double sum = 0.0;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++) {
+            sum += A.values[k] * x[A.col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+inline void spmv_sell(const sell_matrix& A, const double *x, double *y) {
+    int lb, ub;
+    nnz_balanced_range(A.chunk_ptr, A.n_chunks, omp_get_thread_num(), omp_get_num_threads(), lb, ub);
+    for (int c = lb; c < ub; c++) {
+        double tmp[SELL_C] = {};
+        const int *col = A.col.data() + A.chunk_ptr[c];
+        const double *val = A.val.data() + A.chunk_ptr[c];
+        for (int k = 0; k < A.chunk_len[c]; k++) {
+            #pragma omp simd
+            for (int r = 0; r < SELL_C; r++) {
+                tmp[r] += val[k * SELL_C + r] * x[col[k * SELL_C + r]];
+            }
+        }
+        for (int r = 0; r < SELL_C; r++) {
+            int row = A.perm[c * SELL_C + r];
+            if (row >= 0) {
+                y[row] = tmp[r];
+            }
+        }
+    }
+}
+
+inline sell_matrix build_sell(const csr_matrix& A, int sigma) {
+    sell_matrix S;
+    S.n_rows = A.n_rows;
+    S.sigma = sigma;
+    S.n_chunks = (A.n_rows + SELL_C - 1) / SELL_C;
+    S.perm.assign((size_t)S.n_chunks * SELL_C, -1);
+
+    auto length = [&](int i) { return A.row_ptr[i + 1] - A.row_ptr[i]; };
+    for (int i = 0; i < A.n_rows; i++) {
+        S.perm[i] = i;
+    }
+    // сортировка только внутри окна sigma сохраняет локальность по x
+    for (int w = 0; w < A.n_rows; w += sigma) {
+        int we = std::min(w + sigma, A.n_rows);
+        std::stable_sort(S.perm.begin() + w, S.perm.begin() + we,
+                         [&](int p, int q) { return length(p) > length(q); });
+    }
+
+    S.chunk_ptr.assign(S.n_chunks + 1, 0);
+    S.chunk_len.assign(S.n_chunks, 0);
+    for (int c = 0; c < S.n_chunks; c++) {
+        int len = 0;
+        for (int r = 0; r < SELL_C; r++) {
+            int row = S.perm[c * SELL_C + r];
+            if (row >= 0) {
+                len = std::max(len, length(row));
+            }
+        }
+        S.chunk_len[c] = len;
+        S.chunk_ptr[c + 1] = S.chunk_ptr[c] + len * SELL_C;
+    }
+
+    S.col.assign(S.chunk_ptr[S.n_chunks], 0);
+    S.val.assign(S.chunk_ptr[S.n_chunks], 0.0);
+    for (int c = 0; c < S.n_chunks; c++) {
+        for (int r = 0; r < SELL_C; r++) {
+            int row = S.perm[c * SELL_C + r];
+            for (int k = 0; k < S.chunk_len[c]; k++) {
+                size_t pos = S.chunk_ptr[c] + (size_t)k * SELL_C + r;
+                if (row >= 0 && k < length(row)) {
+                    S.col[pos] = A.col_idx[A.row_ptr[row] + k];
+                    S.val[pos] = A.values[A.row_ptr[row] + k];
+                }
+                else {
+                    // дополнение: ноль, умноженный на уже загруженный x
+                    S.col[pos] = (row >= 0 && length(row) > 0) ? A.col_idx[A.row_ptr[row]] : 0;
+                }
+            }
+        }
+    }
+    return S;
+}
+
+// CSR из списка (строка, столбец, значение); повторы складываются
+inline csr_matrix csr_from_triplets(int n_rows, int n_cols, std::vector<int>& rows,
+                                    std::vector<int>& cols, std::vector<double>& vals) {
+    csr_matrix A;
+    A.n_rows = n_rows;
+    A.n_cols = n_cols;
+    A.row_ptr.assign(n_rows + 1, 0);
+    for (int r : rows) {
+        A.row_ptr[r + 1]++;
+    }
+    for (int i = 0; i < n_rows; i++) {
+        A.row_ptr[i + 1] += A.row_ptr[i];
+    }
+
+    std::vector<int> fill(A.row_ptr.begin(), A.row_ptr.end() - 1);
+    A.col_idx.resize(rows.size());
+    A.values.resize(rows.size());
+    for (size_t k = 0; k < rows.size(); k++) {
+        int pos = fill[rows[k]]++;
+        A.col_idx[pos] = cols[k];
+        A.values[pos] = vals[k];
+    }
+
+    // сортируем каждую строку по столбцам и схлопываем повторы
+    std::vector<int> new_ptr(n_rows + 1, 0);
+    int out = 0;
+    for (int i = 0; i < n_rows; i++) {
+        std::vector<std::pair<int, double>> row;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++) {
+            row.push_back({ A.col_idx[k], A.values[k] });
+        }
+        std::sort(row.begin(), row.end(),
+                  [](const std::pair<int, double>& p, const std::pair<int, double>& q) { return p.first < q.first; });
+        for (size_t k = 0; k < row.size(); k++) {
+            if (k > 0 && row[k].first == row[k - 1].first) {
+                A.values[out - 1] += row[k].second;
+                continue;
+            }
+            A.col_idx[out] = row[k].first;
+            A.values[out] = row[k].second;
+            out++;
+        }
+        new_ptr[i + 1] = out;
+    }
+    A.row_ptr = new_ptr;
+    A.col_idx.resize(out);
+    A.values.resize(out);
+    return A;
+}
+
+// Matrix Market: "%%MatrixMarket matrix coordinate real|integer|pattern general|symmetric"
+inline csr_matrix load_matrix_market(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error(path + ": cannot open");
+    }
+    std::string line;
+    std::getline(in, line);
+    std::string banner, object, format, field, symmetry;
+    std::istringstream(line) >> banner >> object >> format >> field >> symmetry;
+    for (auto* s : { &object, &format, &field, &symmetry }) {
+        std::transform(s->begin(), s->end(), s->begin(), ::tolower);
+    }
+    if (banner != "%%MatrixMarket" || object != "matrix" || format != "coordinate") {
+        throw std::runtime_error(path + ": only coordinate Matrix Market files are supported");
+    }
+    bool pattern = (field == "pattern");
+    bool symmetric = (symmetry == "symmetric");
+    if (!pattern && field != "real" && field != "integer") {
+        throw std::runtime_error(path + ": unsupported field '" + field + "'");
+    }
+    if (!symmetric && symmetry != "general") {
+        throw std::runtime_error(path + ": unsupported symmetry '" + symmetry + "'");
+    }
+
+    while (std::getline(in, line) && (line.empty() || line[0] == '%')) {
+    }
+    long long n_rows, n_cols, entries;
+    if (!(std::istringstream(line) >> n_rows >> n_cols >> entries)) {
+        throw std::runtime_error(path + ": bad size line");
+    }
+
+    std::vector<int> rows, cols;
+    std::vector<double> vals;
+    rows.reserve(symmetric ? 2 * entries : entries);
+    cols.reserve(rows.capacity());
+    vals.reserve(rows.capacity());
+    for (long long k = 0; k < entries; k++) {
+        long long i, j;
+        double v = 1.0;
+        if (!(in >> i >> j) || (!pattern && !(in >> v)) || i < 1 || j < 1 || i > n_rows || j > n_cols) {
+            throw std::runtime_error(path + ": bad entry " + std::to_string(k + 1));
+        }
+        rows.push_back((int)i - 1);
+        cols.push_back((int)j - 1);
+        vals.push_back(v);
+        if (symmetric && i != j) {
+            rows.push_back((int)j - 1);
+            cols.push_back((int)i - 1);
+            vals.push_back(v);
+        }
+    }
+    return csr_from_triplets((int)n_rows, (int)n_cols, rows, cols, vals);
+}
+
+// Пятиточечный лапласиан на сетке g x g со сдвигом диагонали:
+// собственные числа в [shift, shift + 8], число обусловленности
+// (shift + 8) / shift; простая итерация с шагом 2 / (2 * shift + 8)
+// сходится с множителем 4 / (shift + 4) на итерацию
+inline csr_matrix generate_shifted_laplacian(int g, double shift) {
+    std::vector<int> rows, cols;
+    std::vector<double> vals;
+    int n = g * g;
+    rows.reserve(5 * (size_t)n);
+    cols.reserve(5 * (size_t)n);
+    vals.reserve(5 * (size_t)n);
+    for (int y = 0; y < g; y++) {
+        for (int x = 0; x < g; x++) {
+            int i = y * g + x;
+            auto add = [&](int j, double v) {
+                rows.push_back(i);
+                cols.push_back(j);
+                vals.push_back(v);
+            };
+            if (y > 0) add(i - g, -1.0);
+            if (x > 0) add(i - 1, -1.0);
+            add(i, 4.0 + shift);
+            if (x < g - 1) add(i + 1, -1.0);
+            if (y < g - 1) add(i + g, -1.0);
+        }
+    }
+    return csr_from_triplets(n, n, rows, cols, vals);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+#include <omp.h>
+
+#include "reduction.h"
+
+// Счётчик выделений памяти: operator new (переопределён в main.cpp)
+// и буферы solver_workspace. По разнице значений до и после цикла
+// решателя видно, что в горячем цикле нет ни одного выделения.
+inline std::atomic<long long>& allocation_count() {
+    static std::atomic<long long> count{0};
+    return count;
+}
+
+// Рабочие векторы решателя. Выделяются один раз (выравнивание по
+// странице), сразу "прогреваются" параллельной записью с тем же
+// static-разбиением, что и в циклах решателя, - страницы попадают на
+// NUMA-узел потока, который будет с ними работать, - и дальше
+// переиспользуются между итерациями и между запусками. Память
+// перевыделяется, только если нужно больше векторов, они длиннее
+// или изменилось число потоков (иначе разбиение first-touch не совпадёт).
+class solver_workspace {
+public:
+    solver_workspace() = default;
+    solver_workspace(const solver_workspace&) = delete;
+    solver_workspace& operator=(const solver_workspace&) = delete;
+
+    ~solver_workspace() {
+        release();
+        release_blocks();
+    }
+
+    // k векторов длины n и массив частичных сумм на каждый поток
+    void reserve(int n, int k) {
+        int threads = omp_get_max_threads();
+        if (n <= length && k <= (int)buffers.size() && threads == placed_threads) {
+            return;
+        }
+        release();
+        length = n;
+        placed_threads = threads;
+        buffers.reserve(k);
+        for (int m = 0; m < k; m++) {
+            buffers.push_back(allocate<double>(n));
+        }
+        partial = allocate<double>(threads * PARTIAL_STRIDE);
+    }
+
+    // sets наборов по count сумм блоков (reduction.h) - отдельно от
+    // векторов, со своим типом и тем же first-touch по блокам
+    void reserve_blocks(int count, int sets) {
+        int threads = omp_get_max_threads();
+        if (count <= block_length && sets <= (int)block_sets.size() && threads == blocks_threads) {
+            return;
+        }
+        release_blocks();
+        block_length = count;
+        blocks_threads = threads;
+        for (int m = 0; m < sets; m++) {
+            block_sets.push_back(allocate<neumaier_t>(count));
+        }
+    }
+
+    double* operator[](int k) const {
+        return buffers[k];
+    }
+
+    neumaier_t* blocks(int set) const {
+        return block_sets[set];
+    }
+
+    double* partials() const {
+        return partial;
+    }
+
+    static const int PARTIAL_STRIDE = 8; // частичные суммы потоков - на разных строках кэша
+
+private:
+    std::vector<double*> buffers;
+    double *partial = nullptr;
+    int length = 0;
+    int placed_threads = 0;
+
+    std::vector<neumaier_t*> block_sets;
+    int block_length = 0;
+    int blocks_threads = 0;
+
+    template <class T>
+    static T* allocate(int n) {
+        void *p = nullptr;
+        if (posix_memalign(&p, 4096, sizeof(T) * (size_t)(n > 0 ? n : 1)) != 0) {
+            throw std::bad_alloc();
+        }
+        allocation_count()++;
+        T *v = (T*)p;
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++) {
+            v[i] = T(); // first-touch
+        }
+        return v;
+    }
+
+    void release() {
+        for (double *p : buffers) {
+            free(p);
+        }
+        buffers.clear();
+        free(partial);
+        partial = nullptr;
+        length = 0;
+    }
+
+    void release_blocks() {
+        for (neumaier_t *p : block_sets) {
+            free(p);
+        }
+        block_sets.clear();
+        block_length = 0;
+    }
+};
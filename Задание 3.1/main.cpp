@@ -1,8 +1,21 @@
 #include <iostream>
+#include <fstream>
+#include <string>
 #include <math.h>
+#include <string.h>
 #include <time.h>
 #include <thread> // РЕАЛИЗАЦИЯ ЧЕРЕЗ std::thread
+#include <type_traits>
 #include <vector>
+#include <atomic>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "thread_pool.hpp"
+#include "bench.h"
+#include "perfcount.h"
+#include "stream.h"
 
 using namespace std;
 
@@ -16,42 +29,296 @@ double cpuSecond() {
 
 
 
-void prepare_matrix(double *a, int start, int end, int cols, int rows) {
+// === NUMA: топология, привязка потоков и статистика по узлам ===
+
+vector<int> cpu_node; // номер NUMA-узла для каждого CPU
+vector<int> allowed_cpus; // CPU, на которых нам разрешено работать
+int num_nodes = 1;
+
+void load_numa_topology() {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    sched_getaffinity(0, sizeof(mask), &mask);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &mask)) {
+            allowed_cpus.push_back(cpu);
+        }
+    }
+    cpu_node.assign(CPU_SETSIZE, 0);
+
+    // /sys/devices/system/node/nodeN/cpulist в формате "0-3,8-11";
+    // если sysfs недоступен, считаем, что узел один
+    for (int node = 0; node < 64; node++) {
+        ifstream f("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        string list;
+        if (!f || !getline(f, list)) {
+            continue;
+        }
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t next = list.find(',', pos);
+            string range = list.substr(pos, next == string::npos ? string::npos : next - pos);
+            size_t dash = range.find('-');
+            int lo = stoi(range);
+            int hi = (dash == string::npos) ? lo : stoi(range.substr(dash + 1));
+            for (int cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++) {
+                cpu_node[cpu] = node;
+            }
+            num_nodes = max(num_nodes, node + 1);
+            if (next == string::npos) {
+                break;
+            }
+            pos = next + 1;
+        }
+    }
+}
+
+int node_of_cpu(int cpu) {
+    return (cpu >= 0 && cpu < (int)cpu_node.size()) ? cpu_node[cpu] : 0;
+}
+
+// политика размещения: "spread" - по очереди по узлам,
+// "close" - сначала заполняем первый узел, "none" - без привязки
+string bind_policy = "spread";
+
+int cpu_for_thread(int thread) {
+    if (bind_policy == "none" || allowed_cpus.empty()) {
+        return -1;
+    }
+    if (bind_policy == "close" || num_nodes == 1) {
+        return allowed_cpus[thread % allowed_cpus.size()];
+    }
+    vector<vector<int>> by_node(num_nodes);
+    for (int cpu : allowed_cpus) {
+        by_node[node_of_cpu(cpu)].push_back(cpu);
+    }
+    vector<int> order;
+    for (size_t k = 0; order.size() < allowed_cpus.size(); k++) {
+        for (auto& cpus : by_node) {
+            if (k < cpus.size()) {
+                order.push_back(cpus[k]);
+            }
+        }
+    }
+    return order[thread % order.size()];
+}
+
+void pin_current_thread(int cpu) {
+    if (cpu < 0) {
+        return;
+    }
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+}
+
+struct thread_stat {
+    int rows, chunks, cpu;
+    double seconds;
+};
+
+vector<thread_stat> last_stats; // статистика последнего запуска run_parallel
+
+void print_placement_report(const vector<thread_stat>& stats) {
+    printf("Placement (bind=%s):\n", bind_policy.c_str());
+    for (size_t t = 0; t < stats.size(); t++) {
+        if (stats[t].chunks == 0) {
+            printf("  thread %zu -> idle (all its chunks were stolen)\n", t);
+            continue;
+        }
+        printf("  thread %zu -> cpu %d (node %d), %d rows in %d chunks\n",
+               t, stats[t].cpu, node_of_cpu(stats[t].cpu), stats[t].rows, stats[t].chunks);
+    }
+}
+
+void print_node_bandwidth(const vector<thread_stat>& stats, int rows, size_t elem_size) {
+    // узел считается закончившим работу, когда закончил его самый медленный поток
+    for (int node = 0; node < num_nodes; node++) {
+        double bytes = 0.0, seconds = 0.0;
+        int count = 0;
+        for (auto& st : stats) {
+            if (st.chunks == 0 || node_of_cpu(st.cpu) != node) {
+                continue;
+            }
+            bytes += elem_size * (double)st.rows * rows;
+            seconds = max(seconds, st.seconds);
+            count++;
+        }
+        if (count > 0) {
+            printf("    node %d: %.3f GB/s (%d threads)\n", node, bytes / seconds * 1.e-9, count);
+        }
+    }
+}
+
+
+
+// bfloat16 - старшие 16 бит float: 8 бит мантиссы, диапазон как у float
+struct bf16 {
+    uint16_t bits;
+
+    bf16() = default;
+    bf16(double value) {
+        float f = (float)value;
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        u += 0x7FFF + ((u >> 16) & 1); // округление к ближайшему чётному
+        bits = (uint16_t)(u >> 16);
+    }
+    operator double() const {
+        uint32_t u = (uint32_t)bits << 16;
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+};
+
+template <typename T> const char* type_name();
+template <> const char* type_name<double>() { return "double"; }
+template <> const char* type_name<float>() { return "float"; }
+template <> const char* type_name<bf16>() { return "bf16"; }
+
+// Элемент тестовой матрицы: (i + j) / 3, а не i + j - целые до 2^24
+// float хранит точно, и погрешность хранения была бы не видна
+inline double matrix_entry(int i, int j) {
+    return (i + j) / 3.0;
+}
+
+// T - тип хранения матрицы; b, c и накопление всегда в double
+template <typename T>
+void prepare_matrix(T *a, int start, int end, int rows) {
     for (int i = start; i < end; i++) {
         for (int j = 0; j < rows; j++) {
-            a[i * rows + j] = i + j;
+            a[(size_t)i * rows + j] = T(matrix_entry(i, j));
         }
     }
 }
 
-void prepare_vector(double *b, int start, int end, int cols, int rows) {
+void prepare_vector(double *b, int start, int end) {
     for (int j = start; j < end; j++) {
         b[j] = j;
     }
 }
 
-void matrix_vector_product(double *a, double *b, double *c, int start, int end, int cols, int rows) {
+template <typename T>
+void matrix_vector_product(const T *a, const double *b, double *c, int start, int end, int rows) {
     for (int i = start; i < end; i++) {
         c[i] = 0.0;
 
         for (int j = 0; j < rows; j++) {
-            c[i] += a[i * rows + j] * b[j];
+            c[i] += (double)a[(size_t)i * rows + j] * b[j];
         }
     }
 }
 
+// Пакетное умножение на k векторов сразу: C = A * B, где B (rows x k) и
+// C (cols x k) хранятся по строкам, т.е. k значений для одного j подряд.
+// За один проход по a обрабатываются все k правых частей, так что матрица
+// читается из памяти один раз, а не k раз. Тайлинг: ROW_TILE строк a,
+// J_TILE столбцов (кусок строк a остаётся в L1) и VEC_TILE векторов
+// (частичные суммы - в регистрах).
+const int ROW_TILE = 4;
+const int J_TILE = 512;
+const int VEC_TILE = 8;
+
+// один тайл ROW_TILE x VN; VN известно при компиляции, поэтому
+// внутренний цикл по векторам полностью разворачивается и векторизуется
+template <int VN, typename T>
+void multi_vector_tile(const T *a, const double *B, double *C, int k,
+                       int ib, int ie, int jb, int je, int vb, int rows) {
+    double acc[ROW_TILE][VN] = {};
+
+    for (int j = jb; j < je; j++) {
+        const double *Bj = B + (size_t)j * k + vb;
+        for (int r = 0; r < ie - ib; r++) {
+            double arj = (double)a[(size_t)(ib + r) * rows + j];
+            for (int v = 0; v < VN; v++) {
+                acc[r][v] += arj * Bj[v];
+            }
+        }
+    }
+
+    for (int r = 0; r < ie - ib; r++) {
+        for (int v = 0; v < VN; v++) {
+            C[(size_t)(ib + r) * k + vb + v] += acc[r][v];
+        }
+    }
+}
+
+template <typename T>
+void matrix_multi_vector_product(const T *a, const double *B, double *C, int k,
+                                 int start, int end, int rows) {
+    for (int i = start; i < end; i++) {
+        for (int v = 0; v < k; v++) {
+            C[(size_t)i * k + v] = 0.0;
+        }
+    }
+
+    for (int ib = start; ib < end; ib += ROW_TILE) {
+        int ie = min(ib + ROW_TILE, end);
+        for (int jb = 0; jb < rows; jb += J_TILE) {
+            int je = min(jb + J_TILE, rows);
+            int vb = 0;
+            for (; vb + VEC_TILE <= k; vb += VEC_TILE) {
+                multi_vector_tile<VEC_TILE>(a, B, C, k, ib, ie, jb, je, vb, rows);
+            }
+            // остаток векторов (k не кратно VEC_TILE) - тайлами 4, 2, 1
+            if (k - vb >= 4) {
+                multi_vector_tile<4>(a, B, C, k, ib, ie, jb, je, vb, rows);
+                vb += 4;
+            }
+            if (k - vb >= 2) {
+                multi_vector_tile<2>(a, B, C, k, ib, ie, jb, je, vb, rows);
+                vb += 2;
+            }
+            if (k - vb >= 1) {
+                multi_vector_tile<1>(a, B, C, k, ib, ie, jb, je, vb, rows);
+            }
+        }
+    }
+}
+
+// Погрешность относительно точного ответа. Для a[i][j] = (i + j) / 3 и
+// b[j] = j: c[i] = (i * sum(j) + sum(j^2)) / 3, округление только в делении.
+// Зачем это нужно - см. Дополнительно/1_floatAscDescPrecision.c
+double last_rel_error = 0.0, last_max_rel_error = 0.0;
+
+void measure_relative_error(const double *c, int cols, int rows) {
+    double s1 = (double)rows * (rows - 1) / 2;
+    double s2 = (double)(rows - 1) * rows * (2.0 * rows - 1) / 6;
+    double num = 0.0, den = 0.0;
+    last_max_rel_error = 0.0;
+    for (int i = 0; i < cols; i++) {
+        double ref = (i * s1 + s2) / 3.0;
+        double diff = c[i] - ref;
+        num += diff * diff;
+        den += ref * ref;
+        if (ref != 0.0) {
+            last_max_rel_error = max(last_max_rel_error, fabs(diff) / fabs(ref));
+        }
+    }
+    last_rel_error = (den > 0.0) ? sqrt(num / den) : 0.0;
+}
+
+void print_relative_error() {
+    printf("    relative error: %.3e (max per-row %.3e)\n", last_rel_error, last_max_rel_error);
+}
+
 
 
 double run_serial(int cols, int rows) {
-    double* a = new double[cols * rows];
+    double* a = new double[(size_t)cols * rows];
     double* b = new double[rows];
     double* c = new double[cols];
 
-    prepare_matrix(a, 0, cols, cols, rows);
-    prepare_vector(b, 0, rows, cols, rows);
+    prepare_matrix(a, 0, cols, rows);
+    prepare_vector(b, 0, rows);
 
+    int region = PERF_REGION("serial");
     double t = cpuSecond();
-    matrix_vector_product(a, b, c, 0, cols, cols, rows);
+    PERF_BEGIN(region);
+    matrix_vector_product(a, b, c, 0, cols, rows);
+    PERF_END(region);
     t = cpuSecond() - t;
 
     delete[] a;
@@ -62,75 +329,375 @@ double run_serial(int cols, int rows) {
 
 
 
-double run_parallel(int cols, int rows, int num_threads) {
-    double* a = new double[cols * rows];
+template <typename T>
+double run_parallel(int cols, int rows, ThreadPool& pool, int grain) {
+    T* a = new T[(size_t)cols * rows];
     double* b = new double[rows];
     double* c = new double[cols];
 
-    vector<thread> threads;
-    int items_per_thread = cols / num_threads;
+    // куски строк раздаются потокам пула одинаково и при инициализации
+    // (first-touch), и при вычислениях; кражи работы нарушают это
+    // только для "украденных" кусков
+    auto init = pool.parallel_for(0, cols, grain, [=](int lb, int ub) {
+        prepare_matrix(a, lb, ub, rows);
+    });
+    auto init_b = pool.parallel_for(0, rows, grain, [=](int lb, int ub) {
+        prepare_vector(b, lb, ub);
+    });
+    for (auto& f : init) {
+        f.get(); // ждём завершения инициализации
+    }
+    for (auto& f : init_b) {
+        f.get();
+    }
 
-    for (int thread = 0; thread < num_threads; ++thread) {
-        int lb = thread * items_per_thread;
-        int ub = (thread == num_threads - 1) ? cols : (thread + 1) * items_per_thread;
+    vector<thread_stat> stats(pool.size(), thread_stat{ 0, 0, -1, 0.0 });
+    int region = PERF_REGION((string("pool ") + type_name<T>()).c_str());
 
-        threads.emplace_back(prepare_matrix, a, lb, ub, cols, rows);
-        threads.emplace_back(prepare_vector, b, lb, ub, cols, rows);
-    }
+    double t = cpuSecond();
 
-    for (auto& thread : threads) {
-        thread.join(); // объединяем все процессы, ждём завершения вычислений
+    auto product = pool.parallel_for(0, cols, grain, [=, &stats](int lb, int ub) {
+        double ts = cpuSecond();
+        PERF_BEGIN(region); // счётчики копятся по кускам в потоке пула
+        matrix_vector_product(a, b, c, lb, ub, rows);
+        PERF_END(region);
+        // куски одного потока выполняются по очереди - гонки нет
+        thread_stat& st = stats[ThreadPool::worker_id()];
+        st.rows += ub - lb;
+        st.chunks++;
+        st.cpu = sched_getcpu();
+        st.seconds += cpuSecond() - ts;
+    });
+    for (auto& f : product) {
+        f.get(); // ждём завершения вычислений
     }
 
-    // удаляем старые отработавшие подпроцессы (иначе будет ошибка)
-    threads.clear();
+    t = cpuSecond() - t;
 
-    double t = cpuSecond();
+    stats.resize(pool.active_threads());
+    last_stats = stats;
+    measure_relative_error(c, cols, rows);
 
-    for (int thread = 0; thread < num_threads; ++thread) {
-        int lb = thread * items_per_thread;
-        int ub = (thread == num_threads - 1) ? rows : (thread + 1) * items_per_thread;
+    delete[] a;
+    delete[] b;
+    delete[] c;
+    return t * 1000; // возвращаем значение в мс
+}
 
-        threads.emplace_back(matrix_vector_product, a, b, c, lb, ub, cols, rows);
+
+
+template <typename T>
+double run_parallel_batched(int cols, int rows, int k, ThreadPool& pool, int grain, double *max_rel_error) {
+    T* a = new T[(size_t)cols * rows];
+    double* B = new double[(size_t)rows * k];
+    double* C = new double[(size_t)cols * k];
+
+    auto init = pool.parallel_for(0, cols, grain, [=](int lb, int ub) {
+        prepare_matrix(a, lb, ub, rows);
+    });
+    auto init_b = pool.parallel_for(0, rows, grain, [=](int lb, int ub) {
+        for (int j = lb; j < ub; j++) {
+            for (int v = 0; v < k; v++) {
+                B[(size_t)j * k + v] = j + v; // v-й вектор: b[j] = j + v
+            }
+        }
+    });
+    for (auto& f : init) {
+        f.get();
     }
+    for (auto& f : init_b) {
+        f.get();
+    }
+
+    double t = cpuSecond();
 
-    for (auto& thread : threads) {
-        thread.join(); // объединяем все процессы, ждём завершения вычислений
+    auto product = pool.parallel_for(0, cols, grain, [=](int lb, int ub) {
+        matrix_multi_vector_product(a, B, C, k, lb, ub, rows);
+    });
+    for (auto& f : product) {
+        f.get(); // ждём завершения вычислений
     }
 
     t = cpuSecond() - t;
 
+    // c_v[i] = sum (i + j)(j + v) / 3 = (i*S1 + S2 + v*(i*rows + S1)) / 3
+    double s1 = (double)rows * (rows - 1) / 2;
+    double s2 = (double)(rows - 1) * rows * (2.0 * rows - 1) / 6;
+    *max_rel_error = 0.0;
+    for (int i = 0; i < cols; i++) {
+        for (int v = 0; v < k; v++) {
+            double ref = (i * s1 + s2 + v * ((double)i * rows + s1)) / 3.0;
+            double got = C[(size_t)i * k + v];
+            if (ref != 0.0) {
+                *max_rel_error = max(*max_rel_error, fabs(got - ref) / fabs(ref));
+            }
+        }
+    }
+
     delete[] a;
-    delete[] b;
-    delete[] c;
+    delete[] B;
+    delete[] C;
     return t * 1000; // возвращаем значение в мс
 }
 
+void run_batched_report(int size, ThreadPool& pool, int grain) {
+    printf("\n=== BATCHED (%dK, %d threads) ===\n", size / 1000, pool.active_threads());
+    double single = 0.0;
+    for (int k = 1; k <= 64; k *= 2) {
+        double max_rel_error;
+        double result = run_parallel_batched<double>(size, size, k, pool, grain, &max_rel_error);
+        double per_vector = result / k;
+        if (k == 1) {
+            single = per_vector;
+        }
+        printf("k = %2d: elapsed time %.6f ms, per vector %.6f ms (%.2f vectors/s), speedup per vector %.3f\n",
+               k, result, per_vector, 1000.0 / per_vector, single / per_vector);
+        printf("    matrix stream: %.3f GB/s, max relative error %.3e\n",
+               sizeof(double) * (double)size * size / (result * 1.e6), max_rel_error);
+    }
+}
+
 
 
-int main() {
+// байты GEMV: матрица читается один раз, плюс векторы b и c
+double gemv_bytes(int size, size_t elem_size) {
+    return elem_size * (double)size * size + sizeof(double) * 2.0 * size;
+}
+
+stream_table_t calibration; // таблица --calibrate; пустая - доли не печатаются
+
+// доля от STREAM на том же числе потоков; она же - потолок roofline в --perf
+void print_stream_fraction(const char *name, int size, size_t elem_size, double ms, int threads) {
+    const stream_result_t *calib = stream_lookup(&calibration, threads);
+    if (calib) {
+        stream_print_fraction(&calibration, name, gemv_bytes(size, elem_size) / (ms * 1.e6), threads);
+        perf_set_stream_bandwidth(stream_attainable(calib, NULL));
+    }
+}
+
+// --perf: счётчики и roofline участка name (perfcount.h); GEMV - 2 флопа
+// на элемент матрицы
+void print_perf_region(const char *name, int size, size_t elem_size, double ms) {
+    perf_print_region(PERF_REGION(name), 2.0 * size * size, gemv_bytes(size, elem_size), ms);
+}
+
+template <typename T>
+void run_parallel_report(const double *serial_results, ThreadPool& pool, int grain, const bench_config_t& bench,
+                         bench_report_t& report) {
+    // для double названия строк те же, что и раньше
+    string prefix = is_same<T, double>::value ? "" : string(" ") + type_name<T>();
+    string kernel = string("pool") + prefix;
+    for (int s = 0; s < bench.nsizes; s++) {
+        int size = (int)bench.sizes[s];
+        bench_stats_t st;
+        BENCH_MEASURE(&bench, st, run_parallel<T>(size, size, pool, grain));
+        bench_record(&report, kernel.c_str(), "serial", size, pool.active_threads(), st);
+        double parallel_result = st.median;
+        printf("%dK%s elapsed time: %.6f ms\n", size / 1000, prefix.c_str(), parallel_result);
+        printf("%dK%s accelerarion ratio: %.6f\n", size / 1000, prefix.c_str(), serial_results[s] / parallel_result);
+        print_node_bandwidth(last_stats, size, sizeof(T));
+        print_relative_error();
+        string name = string("pool ") + type_name<T>();
+        print_stream_fraction(name.c_str(), size, sizeof(T), parallel_result, pool.active_threads());
+        print_perf_region(name.c_str(), size, sizeof(T), parallel_result);
+    }
+}
+
+
+
+// --calibrate: ядра STREAM и погоня за указателем на каждом числе потоков
+// из --threads - на том же пуле с той же привязкой. Часть k из T делает
+// поток пула k (run_on_each: без кражи работы, все стартуют вместе), он
+// же делает first-touch своей части массивов, выделенных заново под
+// каждое число потоков. Итог - в path.
+int run_stream_calibration(ThreadPool& pool, const bench_config_t& bench, const char *path, int mb) {
+    const long n = (long)mb * 1024 * 1024 / sizeof(double);
+    const long lines = n / STREAM_LINE_WORDS;
+    stream_table_t table = { };
+
+    printf("\n=== STREAM CALIBRATION (%d MB per array) ===\n", mb);
+    stream_print_header();
+    for (int i = 0; i < bench.nthreads; i++) {
+        pool.set_active(bench.threads[i]);
+        double *a = new double[n], *b = new double[n], *c = new double[n];
+        size_t *next = new size_t[n];
+
+        pool.run_on_each([=](int tid, int T) {
+            long lb, ub;
+            stream_range(n, tid, T, &lb, &ub);
+            stream_init(a, b, c, lb, ub);
+            stream_range(lines, tid, T, &lb, &ub);
+            stream_chase_build(next, lb, ub, (uint64_t)tid + 1);
+        });
+
+        stream_result_t row = { };
+        row.threads = pool.active_threads();
+        double best[STREAM_KERNELS] = { INFINITY, INFINITY, INFINITY, INFINITY };
+        for (int r = 0; r < STREAM_REPS; r++) {
+            for (int k = 0; k < STREAM_KERNELS; k++) {
+                double t = cpuSecond();
+                pool.run_on_each([=](int tid, int T) {
+                    long lb, ub;
+                    stream_range(n, tid, T, &lb, &ub);
+                    stream_kernel(k, a, b, c, lb, ub);
+                });
+                t = cpuSecond() - t;
+                if (r > 0) {
+                    best[k] = min(best[k], t);
+                }
+            }
+        }
+        for (int k = 0; k < STREAM_KERNELS; k++) {
+            row.gbs[k] = stream_bytes[k] * n / best[k] * 1.e-9;
+        }
+
+        // задержка: все потоки гоняются одновременно, каждый по своему куску
+        vector<double> chase(row.threads, 0.0);
+        atomic<size_t> sink{0};
+        double *times = chase.data();
+        pool.run_on_each([=, &sink](int tid, int T) {
+            long lb, ub;
+            stream_range(lines, tid, T, &lb, &ub);
+            double t = cpuSecond();
+            sink ^= stream_chase_run(next, lb, STREAM_CHASE_STEPS);
+            times[tid] = cpuSecond() - t;
+        });
+        for (double t : chase) {
+            row.latency_ns += t;
+        }
+        row.latency_ns = row.latency_ns / row.threads / STREAM_CHASE_STEPS * 1.e9;
+
+        stream_table_add(&table, &row);
+        stream_print_row(&row);
+        if (sink == (size_t)-1) {
+            printf("\n"); // не даём выбросить погоню
+        }
+        delete[] a;
+        delete[] b;
+        delete[] c;
+        delete[] next;
+    }
+    if (stream_table_save(&table, path) != 0) {
+        return -1;
+    }
+    printf("Calibration saved to %s\n", path);
+    return 0;
+}
+
+
+
+int main(int argc, char *argv[]) {
     int threads[] = { 1, 2, 4, 7, 8, 16, 20, 40, 60, 80 };
+    long sizes[] = { 20000, 40000 };
+    static bench_config_t bench;
+    static bench_report_t report;
+    bench_config_init(&bench, threads, 10, sizes, 2);
+
+    int grain = 256; // строк в одном куске работы
+
+    // --bind spread|close|none - политика привязки потоков
+    // --grain N - размер куска строк для пула
+    // --precision double|float|bf16|all - тип хранения матрицы
+    // --batch N - только пакетное умножение на 1..64 векторов на N потоках
+    // --threads 1,2,4 --sizes 20000,40000 --warmup W --reps R --json FILE --csv FILE - замер (bench.h)
+    // --perf - аппаратные счётчики и roofline по каждому ядру (perfcount.h)
+    // --calibrate [--stream-mb M] - замерить STREAM на --threads и сохранить в --calibration
+    // --calibration FILE - таблица калибровки (stream.h), по умолчанию stream_calibration.csv
+    string precision = "double";
+    int batch_threads = 0;
+    const char *calibration_path = "stream_calibration.csv";
+    bool calibrate = false;
+    int stream_mb = 128;
+    for (int i = 1; i < argc; i++) {
+        if (bench_parse_arg(&bench, argc, argv, &i)) {
+            continue;
+        }
+        if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            bind_policy = argv[++i];
+        }
+        else if (strcmp(argv[i], "--grain") == 0 && i + 1 < argc) {
+            grain = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            precision = argv[++i];
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--perf") == 0) {
+            perf_enable(1);
+        }
+        else if (strcmp(argv[i], "--calibrate") == 0) {
+            calibrate = true;
+        }
+        else if (strcmp(argv[i], "--calibration") == 0 && i + 1 < argc) {
+            calibration_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stream-mb") == 0 && i + 1 < argc) {
+            stream_mb = atoi(argv[++i]);
+        }
+    }
+    if (precision != "double" && precision != "float" && precision != "bf16" && precision != "all") {
+        fprintf(stderr, "unknown precision '%s' (double|float|bf16|all)\n", precision.c_str());
+        return 1;
+    }
+    load_numa_topology();
+    printf("\nNUMA nodes: %d, CPUs: %zu, grain: %d rows\n", num_nodes, allowed_cpus.size(), grain);
+
+    // один пул на весь перебор числа потоков
+    int max_threads = max(1, batch_threads);
+    for (int i = 0; i < bench.nthreads; i++) {
+        max_threads = max(max_threads, bench.threads[i]);
+    }
+    ThreadPool pool(max_threads, [](int id) {
+        pin_current_thread(cpu_for_thread(id));
+    });
+
+    if (calibrate) {
+        return run_stream_calibration(pool, bench, calibration_path, stream_mb) == 0 ? 0 : 1;
+    }
+    if (stream_table_load(&calibration, calibration_path) == 0) {
+        printf("STREAM calibration: %s (%d thread counts)\n", calibration_path, calibration.count);
+    }
+
+    if (batch_threads > 0) {
+        pool.set_active(batch_threads);
+        run_batched_report(20000, pool, grain);
+        return 0;
+    }
 
     // намеренно всё запускаем последовательно - это не ошибка!
+    // каждое время - медиана bench.reps прогонов после bench.warmup прогревочных
     printf("\n=== SERIAL ===\n");
-    double serial_results[2];
-    serial_results[0] = run_serial(20000, 20000);
-    printf("20K elapsed time: %.6f ms\n", serial_results[0]);
-    serial_results[1] = run_serial(40000, 40000);
-    printf("40K elapsed time: %.6f ms\n", serial_results[1]);
+    double serial_results[BENCH_MAX_SWEEP];
+    for (int s = 0; s < bench.nsizes; s++) {
+        int size = (int)bench.sizes[s];
+        bench_stats_t st;
+        BENCH_MEASURE(&bench, st, run_serial(size, size));
+        bench_record(&report, "serial", NULL, size, 1, st);
+        serial_results[s] = st.median;
+        printf("%dK elapsed time: %.6f ms\n", size / 1000, serial_results[s]);
+        print_stream_fraction("serial", size, sizeof(double), serial_results[s], 1);
+        print_perf_region("serial", size, sizeof(double), serial_results[s]);
+    }
 
     printf("\n=== PARALLEL ===\n");
-    for (int i = 0; i < 10; i++) {
-        printf("Number of threads: %d\n", threads[i]);
-        double parallel_results[2];
-        parallel_results[0] = run_parallel(20000, 20000, threads[i]);
-        printf("20K elapsed time: %.6f ms\n", parallel_results[0]);
-        printf("20K accelerarion ratio: %.6f\n", serial_results[0] / parallel_results[0]);
-        parallel_results[1] = run_parallel(40000, 40000, threads[i]);
-        printf("40K elapsed time: %.6f ms\n", parallel_results[1]);
-        printf("40K accelerarion ratio: %.6f\n", serial_results[1] / parallel_results[1]);
+    for (int i = 0; i < bench.nthreads; i++) {
+        pool.set_active(bench.threads[i]);
+        printf("Number of threads: %d\n", bench.threads[i]);
+        if (precision == "double" || precision == "all") {
+            run_parallel_report<double>(serial_results, pool, grain, bench, report);
+        }
+        if (precision == "float" || precision == "all") {
+            run_parallel_report<float>(serial_results, pool, grain, bench, report);
+        }
+        if (precision == "bf16" || precision == "all") {
+            run_parallel_report<bf16>(serial_results, pool, grain, bench, report);
+        }
+        print_placement_report(last_stats);
         printf("------\n");
     }
 
+    bench_finish(&bench, &report, "task3.1");
     return 0;
 }
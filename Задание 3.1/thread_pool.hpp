@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул постоянных потоков с собственной очередью (deque) у каждого потока
+// и кражей работы: владелец берёт задачи с конца своей очереди, а
+// простаивающие потоки забирают задачи с начала чужих очередей.
+// Потоки создаются один раз, поэтому цена std::thread не платится
+// на каждый вызов run_parallel.
+class ThreadPool {
+public:
+    // on_start вызывается в каждом потоке перед началом работы
+    // (например, для привязки к CPU)
+    explicit ThreadPool(int num_threads, std::function<void(int)> on_start = nullptr)
+        : queues(num_threads), active(num_threads) {
+        for (int id = 0; id < num_threads; id++) {
+            workers.emplace_back([this, id, on_start]() {
+                worker_id_ref() = id;
+                if (on_start) {
+                    on_start(id);
+                }
+                worker_loop(id);
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stop = true;
+        }
+        wakeup.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    int size() const {
+        return (int)workers.size();
+    }
+
+    // Сколько потоков участвуют в работе (остальные спят). Менять только
+    // когда в пуле нет задач - так один пул обслуживает весь перебор
+    // числа потоков в main.
+    void set_active(int num_threads) {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            active = std::max(1, std::min(num_threads, size()));
+        }
+        wakeup.notify_all();
+    }
+
+    int active_threads() const {
+        return active;
+    }
+
+    // номер потока пула, в котором выполняется код (-1 вне пула)
+    static int worker_id() {
+        return worker_id_ref();
+    }
+
+    // Разбивает [begin, end) на куски по grain элементов и раздаёт их
+    // активным потокам непрерывными блоками (кусок k -> поток k*n/chunks),
+    // так что при одинаковых параметрах инициализация и вычисления
+    // попадают на одни и те же потоки. f(lb, ub) получает полуинтервал.
+    template <class F>
+    std::vector<std::future<void>> parallel_for(int begin, int end, int grain, F f) {
+        std::vector<std::future<void>> futures;
+        if (end <= begin) {
+            return futures;
+        }
+        grain = std::max(1, grain);
+        int chunks = (end - begin + grain - 1) / grain;
+        int n = active;
+
+        for (int k = 0; k < chunks; k++) {
+            int lb = begin + k * grain;
+            int ub = std::min(end, lb + grain);
+            auto task = std::make_shared<std::packaged_task<void()>>([f, lb, ub]() { f(lb, ub); });
+            futures.push_back(task->get_future());
+            push((int)((long long)k * n / chunks), [task]() { (*task)(); });
+        }
+        notify();
+        return futures;
+    }
+
+    // f(id, T) ровно один раз в каждом из T активных потоков, на потоке id:
+    // задачи кладутся в закреплённую часть очереди, которую не крадут, и
+    // все T вызовов стартуют вместе после общего барьера. Возвращается,
+    // когда все закончили. Для замеров, где важно, какой поток что делает
+    // (first-touch, одновременная нагрузка); не вызывать из потока пула.
+    template <class F>
+    void run_on_each(F f) {
+        const int n = active;
+        auto arrived = std::make_shared<std::atomic<int>>(0);
+        std::vector<std::future<void>> futures;
+        for (int id = 0; id < n; id++) {
+            auto task = std::make_shared<std::packaged_task<void()>>([f, id, n, arrived]() {
+                arrived->fetch_add(1);
+                while (arrived->load() < n) {
+                    std::this_thread::yield();
+                }
+                f(id, n);
+            });
+            futures.push_back(task->get_future());
+            push_pinned(id, [task]() { (*task)(); });
+        }
+        notify();
+        for (auto& done : futures) {
+            done.get();
+        }
+    }
+
+    template <class F>
+    std::future<void> submit(F f) {
+        auto task = std::make_shared<std::packaged_task<void()>>(f);
+        auto future = task->get_future();
+        int id = worker_id();
+        push((id >= 0 && id < active) ? id : next_queue++ % active, [task]() { (*task)(); });
+        notify();
+        return future;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::deque<std::function<void()>> pinned; // только для владельца (run_on_each)
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<Queue> queues;
+    std::atomic<int> pending{0}; // задач во всех очередях
+    std::atomic<int> active;
+    std::atomic<unsigned> next_queue{0};
+
+    std::mutex sleep_mutex;
+    std::condition_variable wakeup;
+    bool stop = false;
+
+    static int& worker_id_ref() {
+        thread_local int id = -1;
+        return id;
+    }
+
+    void push(int queue, std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(queues[queue].mutex);
+        queues[queue].tasks.push_back(std::move(task));
+        pending++;
+    }
+
+    void push_pinned(int queue, std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(queues[queue].mutex);
+        queues[queue].pinned.push_back(std::move(task));
+        pending++;
+    }
+
+    void notify() {
+        // берём мьютекс, чтобы не потерять пробуждение потока,
+        // который как раз проверяет условие ожидания
+        { std::lock_guard<std::mutex> lock(sleep_mutex); }
+        wakeup.notify_all();
+    }
+
+    bool pop_own(int id, std::function<void()>& task) {
+        std::lock_guard<std::mutex> lock(queues[id].mutex);
+        if (!queues[id].pinned.empty()) {
+            task = std::move(queues[id].pinned.front());
+            queues[id].pinned.pop_front();
+            pending--;
+            return true;
+        }
+        if (queues[id].tasks.empty()) {
+            return false;
+        }
+        task = std::move(queues[id].tasks.back());
+        queues[id].tasks.pop_back();
+        pending--;
+        return true;
+    }
+
+    bool steal(int id, std::function<void()>& task) {
+        int n = active;
+        for (int k = 1; k < n; k++) {
+            Queue& victim = queues[(id + k) % n];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                pending--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(int id) {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                wakeup.wait(lock, [&]() { return stop || (id < active && pending > 0); });
+                if (stop && pending == 0) {
+                    return;
+                }
+            }
+
+            std::function<void()> task;
+            if (pop_own(id, task) || steal(id, task)) {
+                task();
+            }
+        }
+    }
+};
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<execution>)
+#include <execution>
+#endif
+#ifdef HAVE_TBB
+#include <tbb/global_control.h>
+#endif
+#include <omp.h>
+
+#include "jacobi.hpp"
+
+// Переносимые исполнители для основного цикла iterate() - чтобы
+// cpu_host/cpu_multicore параллелились и без pgc++ (GCC и Clang
+// #pragma acc игнорируют):
+//  - acc:     исходный цикл с #pragma acc (по умолчанию при сборке pgc++);
+//  - omp:     omp parallel for по строкам (по умолчанию в остальных сборках);
+//  - threads: постоянные std::thread, у каждого своя полоса строк, после
+//             каждого прохода - барьер;
+//  - par:     std::transform_reduce(std::execution::par) по строкам (в
+//             libstdc++ параллелится только с TBB, иначе идёт последовательно).
+// Ядро у всех одно (stencil_row_eps), epsilon - максимум, от порядка не
+// зависит, поэтому сетка и число итераций совпадают побитово.
+
+enum class backend_kind { acc, omp, threads, par };
+
+inline backend_kind parse_backend(const std::string& name) {
+    if (name == "acc") return backend_kind::acc;
+    if (name == "omp") return backend_kind::omp;
+    if (name == "threads") return backend_kind::threads;
+    if (name == "par") return backend_kind::par;
+    throw std::invalid_argument("unknown backend '" + name + "' (acc|omp|threads|par)");
+}
+
+inline const char* backend_name(backend_kind b) {
+    const char *names[] = { "acc", "omp", "threads", "par" };
+    return names[(int)b];
+}
+
+inline backend_kind default_backend() {
+#ifdef _OPENACC
+    return backend_kind::acc;
+#else
+    return backend_kind::omp;
+#endif
+}
+
+// участок perfcount.h для --perf (par не размечен: строки раздаёт TBB)
+inline const char* backend_region(backend_kind b) {
+    const char *names[] = { "stencil omp", "stencil omp", "stencil threads", "stencil par" };
+    return names[(int)b];
+}
+
+// --perf: счётчики исполнителя за прогон и roofline шаблона. На ячейку -
+// 7 операций (6 в шаблоне, 1 в разности для epsilon), минимальный обмен -
+// чтение A и запись Anew, 16 байт.
+inline void print_backend_perf(backend_kind backend, int m, int n, int sweeps, double ms) {
+    const double cells = (double)(m - 2) * (n - 2) * sweeps;
+    perf_print_region(PERF_REGION(backend_region(backend)), 7.0 * cells, 16.0 * cells, ms);
+}
+
+// Барьер для фиксированного числа потоков (std::barrier - только C++20).
+// Смена фазы: последний пришедший обнуляет счётчик и увеличивает phase;
+// остальные крутятся на phase, а потом засыпают.
+class spin_barrier {
+public:
+    explicit spin_barrier(int count) : count(count) {}
+
+    void wait() {
+        int my_phase = phase.load(std::memory_order_acquire);
+        if (arrived.fetch_add(1, std::memory_order_acq_rel) == count - 1) {
+            arrived.store(0, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                phase.fetch_add(1, std::memory_order_acq_rel);
+            }
+            cv.notify_all();
+            return;
+        }
+        for (int spin = 0; spin < 4096; spin++) {
+            if (phase.load(std::memory_order_acquire) != my_phase) {
+                return;
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return phase.load(std::memory_order_acquire) != my_phase; });
+    }
+
+private:
+    const int count;
+    std::atomic<int> arrived{0};
+    std::atomic<int> phase{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+// Пул постоянных потоков: run(f) вызывает f(tid) во всех потоках пула
+// (tid 0 - вызывающий поток) и ждёт, пока все вернутся. Внутри f потоки
+// синхронизируются через barrier().
+class band_pool {
+public:
+    explicit band_pool(int threads) : threads(std::max(1, threads)), sync(this->threads) {
+        for (int tid = 1; tid < this->threads; tid++) {
+            workers.emplace_back([this, tid] {
+                int seen = 0;
+                while (true) {
+                    std::function<void(int)> job;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [&] { return generation != seen || stop; });
+                        if (stop) {
+                            return;
+                        }
+                        seen = generation;
+                        job = task;
+                    }
+                    job(tid);
+                    sync.wait(); // конец run()
+                }
+            });
+        }
+    }
+
+    band_pool(const band_pool&) = delete;
+    band_pool& operator=(const band_pool&) = delete;
+
+    ~band_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        for (std::thread& w : workers) {
+            w.join();
+        }
+    }
+
+    int size() const {
+        return threads;
+    }
+
+    void run(const std::function<void(int)>& f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = f;
+            generation++;
+        }
+        cv.notify_all();
+        f(0);
+        sync.wait();
+    }
+
+    void barrier() {
+        sync.wait();
+    }
+
+private:
+    int threads;
+    spin_barrier sync;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::function<void(int)> task;
+    int generation = 0;
+    bool stop = false;
+};
+
+// Вызывается после каждой итерации: сетка после неё, номер итерации
+// (считая с 1) и её epsilon - например, checkpointer::step
+using sweep_hook = std::function<void(const double *grid, int iteration, double epsilon)>;
+
+// Итерации до epsilon < epsilonMin или iterMax (число проходов, как в
+// iterate_checked) на исполнителе backend с threads потоками (0 - по
+// умолчанию). Итог - в A. first > 0 - продолжение с итерации first
+// (--resume): A и epsilon уже восстановлены, счёт проходов идёт с first.
+inline int iterate_backend(backend_kind backend, double *&A, double *&Anew, const stencil_params& p, int iterMax,
+                           double epsilonMin, double& epsilon, int threads = 0,
+                           const sweep_hook& on_sweep = nullptr, int first = 0) {
+    const int m = p.m, n = p.n;
+    int sweeps = first;
+    if (first == 0) {
+        epsilon = 1.0;
+    }
+
+    const int region = PERF_REGION(backend_region(backend));
+
+    if (backend == backend_kind::omp || backend == backend_kind::acc) {
+        int saved = omp_get_max_threads();
+        if (threads > 0) {
+            omp_set_num_threads(threads);
+        }
+        while (sweeps < iterMax && epsilon >= epsilonMin) {
+            epsilon = jacobi_sweep_eps(A, Anew, p, region);
+            std::swap(A, Anew);
+            sweeps++;
+            if (on_sweep) {
+                on_sweep(A, sweeps, epsilon);
+            }
+        }
+        omp_set_num_threads(saved);
+    }
+    else if (backend == backend_kind::threads) {
+        band_pool pool((threads > 0) ? threads : (int)std::max(1u, std::thread::hardware_concurrency()));
+        const int T = pool.size();
+        const int STRIDE = 8; // epsilon потоков - на разных строках кэша
+        std::vector<double> partial(2 * T * STRIDE, 0.0);
+        double *a = A, *anew = Anew;
+        const double eps0 = epsilon; // epsilon пишет tid 0 в конце
+
+        pool.run([&](int tid) {
+            // полоса строк [lo, hi) внутренних строк 1..m-2
+            int rows = m - 2;
+            int lo = 1 + (int)((long long)rows * tid / T), hi = 1 + (int)((long long)rows * (tid + 1) / T);
+            double *src = a, *dst = anew;
+            double eps = eps0;
+            int done = first;
+            while (done < iterMax && eps >= epsilonMin) {
+                double local = 0.0;
+                PERF_BEGIN(region);
+                for (int i = lo; i < hi; i++) {
+                    local = std::max(local, stencil_row_eps(dst + (size_t)i*n, src + (size_t)(i-1)*n,
+                                                            src + (size_t)i*n, src + (size_t)(i+1)*n, 1, n - 1, p));
+                }
+                PERF_END(region);
+                // два набора слотов по очереди: пока одни читают, в другие уже пишут
+                double *slots = partial.data() + (done & 1) * T * STRIDE;
+                slots[tid * STRIDE] = local;
+                pool.barrier();
+                eps = 0.0;
+                for (int t = 0; t < T; t++) {
+                    eps = std::max(eps, slots[t * STRIDE]);
+                }
+                std::swap(src, dst);
+                done++;
+                // src (бывший dst) дописан всеми: следующий проход пишет в другой
+                // буфер, а в этот - только после барьера, до которого дойдёт tid 0
+                if (tid == 0 && on_sweep) {
+                    on_sweep(src, done, eps);
+                }
+            }
+            if (tid == 0) {
+                sweeps = done;
+                epsilon = eps;
+            }
+        });
+        if ((sweeps - first) & 1) {
+            std::swap(A, Anew);
+        }
+    }
+    else {
+#if defined(__cpp_lib_execution) && __cpp_lib_execution >= 201603
+#ifdef HAVE_TBB
+        std::unique_ptr<tbb::global_control> limit;
+        if (threads > 0) {
+            limit.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism, threads));
+        }
+#endif
+        std::vector<int> rows(m - 2);
+        std::iota(rows.begin(), rows.end(), 1);
+        while (sweeps < iterMax && epsilon >= epsilonMin) {
+            const double *src = A;
+            double *dst = Anew;
+            epsilon = std::transform_reduce(std::execution::par, rows.begin(), rows.end(), 0.0,
+                [](double x, double y) { return std::max(x, y); },
+                [&](int i) {
+                    return stencil_row_eps(dst + (size_t)i*n, src + (size_t)(i-1)*n, src + (size_t)i*n,
+                                           src + (size_t)(i+1)*n, 1, n - 1, p);
+                });
+            std::swap(A, Anew);
+            sweeps++;
+            if (on_sweep) {
+                on_sweep(A, sweeps, epsilon);
+            }
+        }
+#else
+        throw std::invalid_argument("backend 'par' needs C++17 <execution>");
+#endif
+    }
+    return sweeps;
+}
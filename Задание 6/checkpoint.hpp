@@ -0,0 +1,184 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Контрольные точки для долгих расчётов: раз в every итераций сетка A,
+// номер итерации и epsilon сохраняются в checkpoint_MxN.bin, и с --resume
+// расчёт продолжается с последней сохранённой итерации - результат тот же,
+// что и без перерыва.
+//
+// Файл отображён в память (mmap). В нём заголовок и два слота под сетку;
+// запись идёт в слот, который сейчас не последний, и только после msync
+// данных в заголовке переключается номер текущего слота - если процесс
+// убьют посреди записи, в файле останется предыдущая целая точка.
+//
+// Основной поток только копирует A в промежуточный буфер (memcpy) и сразу
+// идёт дальше; в слот и на диск точку пишет фоновый поток. Если к
+// следующей точке он ещё не закончил - основной поток его ждёт; это
+// ожидание вместе с копированием и есть накладные расходы, их печатает
+// report().
+
+struct checkpoint_policy {
+    int every = 0;       // 0 - не сохранять
+    bool resume = false; // начать с последней точки из файла
+};
+
+class checkpointer {
+public:
+    checkpointer(int m, int n, const checkpoint_policy& policy) : m(m), n(n), policy(policy) {
+        path = "checkpoint_" + std::to_string(m) + "x" + std::to_string(n) + ".bin";
+        size_t page = sysconf(_SC_PAGESIZE);
+        slot_bytes = ((size_t)m * n * sizeof(double) + page - 1) / page * page;
+        data_offset = (sizeof(header) + page - 1) / page * page;
+        file_bytes = data_offset + 2 * slot_bytes;
+
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        struct stat st;
+        bool fresh = fstat(fd, &st) != 0 || (size_t)st.st_size != file_bytes;
+        if (fresh && ftruncate(fd, file_bytes) != 0) {
+            throw std::runtime_error("cannot resize " + path);
+        }
+        base = (char*)mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("cannot mmap " + path);
+        }
+        if (fresh || std::memcmp(head()->magic, "JCK1", 4) != 0 || head()->m != m || head()->n != n) {
+            header h;
+            std::memcpy(head(), &h, sizeof(h));
+            head()->m = m;
+            head()->n = n;
+            msync(base, data_offset, MS_SYNC);
+        }
+        if (policy.every > 0) {
+            staging.resize((size_t)m * n);
+        }
+    }
+
+    checkpointer(const checkpointer&) = delete;
+    checkpointer& operator=(const checkpointer&) = delete;
+
+    ~checkpointer() {
+        if (writer.joinable()) {
+            writer.join();
+        }
+        munmap(base, file_bytes);
+        close(fd);
+    }
+
+    // последняя целая точка -> A и epsilon; возвращает её итерацию
+    // (0 - точки нет или resume не запрошен, A не меняется). Точка не
+    // раньше iterMax - ошибка: считать нечего, а результатом стала бы она.
+    // Исключение ловит jacobi_driver::run (сообщение и код 1), файл точки
+    // остаётся как был
+    int restore(double *A, double& epsilon, int iterMax) {
+        if (!policy.resume || head()->current < 0) {
+            return 0;
+        }
+        int s = head()->current;
+        if (head()->iteration[s] >= iterMax) {
+            throw std::invalid_argument(path + " is at iteration " + std::to_string(head()->iteration[s]) +
+                                        ", --iter " + std::to_string(iterMax) + " must be above it to resume");
+        }
+        std::memcpy(A, slot(s), (size_t)m * n * sizeof(double));
+        epsilon = head()->epsilon[s];
+        resumed_at = (int)head()->iteration[s];
+        return resumed_at;
+    }
+
+    // вызывать после каждой итерации iteration (считая с 1), epsilon - её
+    void step(const double *A, int iteration, double epsilon) {
+        if (policy.every <= 0 || iteration % policy.every != 0) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (writer.joinable()) {
+            writer.join(); // предыдущая точка ещё пишется
+        }
+        std::memcpy(staging.data(), A, staging.size() * sizeof(double));
+        writer = std::thread(&checkpointer::write, this, iteration, epsilon);
+        auto end = std::chrono::steady_clock::now();
+
+        if (saves > 0) {
+            interval_ms += std::chrono::duration<double, std::milli>(start - last_save).count();
+        }
+        stall_ms += std::chrono::duration<double, std::milli>(end - start).count();
+        last_save = end;
+        saves++;
+    }
+
+    void report() {
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (resumed_at > 0) {
+            std::printf("Resumed from checkpoint at iteration %d\n", resumed_at);
+        }
+        if (saves == 0) {
+            return;
+        }
+        double stall = stall_ms / saves;
+        double interval = (saves > 1) ? interval_ms / (saves - 1) : 0.0;
+        std::printf("Checkpoints: %d every %d iterations to %s\n", saves, policy.every, path.c_str());
+        std::printf("Checkpoint overhead: %.3f ms stall per interval of %.1f ms (%.2f%%), %.1f ms background write\n",
+                    stall, interval, (interval > 0.0) ? 100.0 * stall / interval : 0.0, write_ms / saves);
+    }
+
+private:
+    struct header {
+        char magic[4] = { 'J', 'C', 'K', '1' };
+        int32_t m = 0, n = 0;
+        int32_t current = -1;     // последний целый слот, -1 - нет точек
+        int64_t iteration[2] = { 0, 0 };
+        double epsilon[2] = { 0.0, 0.0 };
+    };
+
+    int m, n;
+    checkpoint_policy policy;
+    std::string path;
+    int fd = -1;
+    char *base = nullptr;
+    size_t slot_bytes, data_offset, file_bytes;
+
+    std::vector<double> staging;
+    std::thread writer;
+    int saves = 0, resumed_at = 0;
+    double stall_ms = 0.0, interval_ms = 0.0, write_ms = 0.0; // write_ms пишет только фоновый поток
+    std::chrono::steady_clock::time_point last_save;
+
+    header* head() {
+        return (header*)base;
+    }
+
+    char* slot(int s) {
+        return base + data_offset + s * slot_bytes;
+    }
+
+    void write(int iteration, double epsilon) {
+        auto start = std::chrono::steady_clock::now();
+        int s = (head()->current == 0) ? 1 : 0;
+        std::memcpy(slot(s), staging.data(), staging.size() * sizeof(double));
+        msync(slot(s), slot_bytes, MS_SYNC);
+
+        head()->iteration[s] = iteration;
+        head()->epsilon[s] = epsilon;
+        msync(base, data_offset, MS_SYNC);
+        head()->current = s; // точка целиком на диске - переключаемся на неё
+        msync(base, data_offset, MS_SYNC);
+        write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
@@ -0,0 +1,347 @@
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <mpi.h>
+#include <boost/program_options.hpp>
+
+#include "output.hpp"
+
+using namespace std;
+namespace opt = boost::program_options;
+
+// Распределённый вариант iterate() из cpu_multicore.cpp: сетка m x n
+// режется на блоки строк (--decomp rows) или на двумерные блоки
+// (--decomp 2d) по процессам MPI. У каждого блока - рамка из одной
+// ячейки (гало) под соседние строки/столбцы. На каждой итерации:
+//  1. MPI_Irecv / MPI_Isend граничных строк и столбцов соседям;
+//  2. пока они идут - пересчёт внутренности блока (гало не нужно);
+//  3. MPI_Waitall и пересчёт полосы вдоль краёв блока;
+//  4. MPI_Allreduce(max) для epsilon.
+// Шаблон, начальная сетка и порядок сложения - как в cpu_multicore, так
+// что результат совпадает с ним побитово (и для m != n, см. тесты mpi_* в
+// CMakeLists.txt). Итог пишется через MPI-IO в output_MxN.bin
+// (формат --output binary из output.hpp): каждый процесс пишет свой блок
+// через subarray-вид файла.
+
+struct decomposition {
+    MPI_Comm cart;
+    int rank, size;
+    int dims[2];   // процессов по строкам и по столбцам
+    int coords[2];
+    int up, down, left, right; // соседи (MPI_PROC_NULL на краю)
+    int r0, lr;    // первые глобальная строка и число строк блока
+    int c0, lc;    // то же для столбцов
+};
+
+struct mpi_result {
+    int iterations = 0;
+    double epsilon = 0.0;
+    double ms = 0.0;       // счёт (без записи)
+    double wait_ms = 0.0;  // ожидание гало (MPI_Waitall), max по процессам
+    double write_ms = 0.0; // MPI-IO
+};
+
+// [start, start + count) - доля k-го из parts при делении total
+static void split(int total, int parts, int k, int& start, int& count) {
+    int base = total / parts, extra = total % parts;
+    count = base + (k < extra ? 1 : 0);
+    start = k * base + min(k, extra);
+}
+
+decomposition decompose(MPI_Comm comm, int m, int n, bool twoD) {
+    decomposition d;
+    MPI_Comm_size(comm, &d.size);
+    d.dims[0] = d.dims[1] = 0;
+    if (!twoD) {
+        d.dims[0] = d.size;
+        d.dims[1] = 1;
+    }
+    MPI_Dims_create(d.size, 2, d.dims);
+    int periods[2] = { 0, 0 };
+    MPI_Cart_create(comm, 2, d.dims, periods, 0, &d.cart);
+    MPI_Comm_rank(d.cart, &d.rank);
+    MPI_Cart_coords(d.cart, d.rank, 2, d.coords);
+    MPI_Cart_shift(d.cart, 0, 1, &d.up, &d.down);
+    MPI_Cart_shift(d.cart, 1, 1, &d.left, &d.right);
+    split(m, d.dims[0], d.coords[0], d.r0, d.lr);
+    split(n, d.dims[1], d.coords[1], d.c0, d.lc);
+    return d;
+}
+
+// граница - как в initialize() cpu_multicore: углы 10, 20, 20, 30 и
+// линейная интерполяция вдоль сторон, внутри нули
+static double initial_value(int gi, int gj, int m, int n) {
+    if ((gi == 0 || gi == m-1) && (gj == 0 || gj == n-1)) {
+        return 10.0 + 10.0 * (gi == m-1) + 10.0 * (gj == n-1); // углы заданы точно, не интерполяцией
+    }
+    if (gi == 0) return 10.0 + (20.0 - 10.0)/(n-1)*gj;
+    if (gi == m-1) return 20.0 + (30.0 - 20.0)/(n-1)*gj;
+    if (gj == 0) return 10.0 + (20.0 - 10.0)/(m-1)*gi;
+    if (gj == n-1) return 20.0 + (30.0 - 20.0)/(m-1)*gi;
+    return 0.0;
+}
+
+class local_grid {
+public:
+    local_grid(const decomposition& d, int m, int n) : d(d), m(m), n(n), ld(d.lc + 2) {
+        A.assign((size_t)(d.lr + 2) * ld, 0.0);
+        for (int li = 0; li < d.lr; li++) {
+            for (int lj = 0; lj < d.lc; lj++) {
+                A[idx(li, lj)] = initial_value(d.r0 + li, d.c0 + lj, m, n);
+            }
+        }
+        Anew = A;
+        MPI_Type_vector(d.lr, 1, ld, MPI_DOUBLE, &column);
+        MPI_Type_commit(&column);
+    }
+
+    ~local_grid() {
+        MPI_Type_free(&column);
+    }
+
+    // одна итерация; возвращает глобальный epsilon
+    double sweep(double thau, double& wait_ms) {
+        MPI_Request req[8];
+        int nreq = 0;
+        double *a = A.data();
+        // приём в гало, отправка своих крайних строк/столбцов
+        MPI_Irecv(a + idx(-1, 0), d.lc, MPI_DOUBLE, d.up, 0, d.cart, &req[nreq++]);
+        MPI_Irecv(a + idx(d.lr, 0), d.lc, MPI_DOUBLE, d.down, 1, d.cart, &req[nreq++]);
+        MPI_Irecv(a + idx(0, -1), 1, column, d.left, 2, d.cart, &req[nreq++]);
+        MPI_Irecv(a + idx(0, d.lc), 1, column, d.right, 3, d.cart, &req[nreq++]);
+        MPI_Isend(a + idx(0, 0), d.lc, MPI_DOUBLE, d.up, 1, d.cart, &req[nreq++]);
+        MPI_Isend(a + idx(d.lr - 1, 0), d.lc, MPI_DOUBLE, d.down, 0, d.cart, &req[nreq++]);
+        MPI_Isend(a + idx(0, 0), 1, column, d.left, 3, d.cart, &req[nreq++]);
+        MPI_Isend(a + idx(0, d.lc - 1), 1, column, d.right, 2, d.cart, &req[nreq++]);
+
+        // внутренность блока - без гало
+        double epsilon = update(1, d.lr - 1, 1, d.lc - 1, thau);
+
+        double t = MPI_Wtime();
+        MPI_Waitall(nreq, req, MPI_STATUSES_IGNORE);
+        wait_ms += (MPI_Wtime() - t) * 1000;
+
+        // полоса вдоль краёв блока
+        epsilon = max(epsilon, update(0, 1, 0, d.lc, thau));
+        if (d.lr > 1) {
+            epsilon = max(epsilon, update(d.lr - 1, d.lr, 0, d.lc, thau));
+        }
+        epsilon = max(epsilon, update(1, d.lr - 1, 0, 1, thau));
+        if (d.lc > 1) {
+            epsilon = max(epsilon, update(1, d.lr - 1, d.lc - 1, d.lc, thau));
+        }
+
+        A.swap(Anew);
+        MPI_Allreduce(MPI_IN_PLACE, &epsilon, 1, MPI_DOUBLE, MPI_MAX, d.cart);
+        return epsilon;
+    }
+
+    // блок в output_MxN.bin: заголовок пишет процесс 0, данные - все, каждый в свой subarray
+    void write(const string& name) {
+        vector<double> block((size_t)d.lr * d.lc);
+        for (int li = 0; li < d.lr; li++) {
+            copy(&A[idx(li, 0)], &A[idx(li, 0)] + d.lc, &block[(size_t)li * d.lc]);
+        }
+
+        MPI_File f;
+        int rc = MPI_File_open(d.cart, name.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &f);
+        if (rc != MPI_SUCCESS) { // у файлов по умолчанию MPI_ERRORS_RETURN - сами не упадут
+            if (d.rank == 0) {
+                char msg[MPI_MAX_ERROR_STRING];
+                int len = 0;
+                MPI_Error_string(rc, msg, &len);
+                cerr << "cannot open " << name << ": " << string(msg, len) << "\n";
+            }
+            MPI_Abort(d.cart, 1);
+        }
+        MPI_File_set_size(f, 0);
+        if (d.rank == 0) {
+            result_header h;
+            h.m = m;
+            h.n = n;
+            h.payload = (uint64_t)m * n * sizeof(double);
+            MPI_File_write_at(f, 0, &h, sizeof(h), MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+
+        int sizes[2] = { m, n }, subsizes[2] = { d.lr, d.lc }, starts[2] = { d.r0, d.c0 };
+        MPI_Datatype view;
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &view);
+        MPI_Type_commit(&view);
+        MPI_File_set_view(f, sizeof(result_header), MPI_DOUBLE, view, "native", MPI_INFO_NULL);
+        MPI_File_write_all(f, block.data(), (int)block.size(), MPI_DOUBLE, MPI_STATUS_IGNORE);
+        MPI_File_close(&f);
+        MPI_Type_free(&view);
+    }
+
+private:
+    const decomposition& d;
+    int m, n;
+    int ld; // строка локального массива: lc + 2 (гало слева и справа)
+    vector<double> A, Anew;
+    MPI_Datatype column;
+
+    // индекс (li, lj) блока, li/lj от -1 (гало) до lr/lc (гало)
+    size_t idx(int li, int lj) const {
+        return (size_t)(li + 1) * ld + (lj + 1);
+    }
+
+    // пересчёт [li0, li1) x [lj0, lj1) блока, кроме глобальной границы
+    double update(int li0, int li1, int lj0, int lj1, double thau) {
+        li0 = max(li0, 1 - d.r0);
+        li1 = min(li1, m - 1 - d.r0);
+        lj0 = max(lj0, 1 - d.c0);
+        lj1 = min(lj1, n - 1 - d.c0);
+        const double *a = A.data();
+        double *anew = Anew.data();
+        double epsilon = 0.0;
+        #pragma omp parallel for schedule(static) reduction(max:epsilon)
+        for (int li = li0; li < li1; li++) {
+            for (int lj = lj0; lj < lj1; lj++) {
+                size_t k = idx(li, lj);
+                anew[k] = thau * (a[k - 1] + a[k + 1] + a[k - ld] + a[k + ld]);
+                epsilon = max(epsilon, fabs(anew[k] - a[k]));
+            }
+        }
+        return epsilon;
+    }
+};
+
+// Решение на коммуникаторе comm; все его процессы вызывают одновременно
+mpi_result solve(MPI_Comm comm, int m, int n, int iterMax, double epsilonMin, bool twoD, bool write) {
+    decomposition d = decompose(comm, m, n, twoD);
+    mpi_result res;
+    {
+        local_grid grid(d, m, n);
+
+        MPI_Barrier(d.cart);
+        double start = MPI_Wtime();
+        double epsilon = 1.0;
+        int iter = 0;
+        while (iter < iterMax && epsilon >= epsilonMin) {
+            epsilon = grid.sweep(0.25, res.wait_ms);
+            iter++;
+        }
+        res.ms = (MPI_Wtime() - start) * 1000;
+        res.iterations = iter;
+        res.epsilon = epsilon;
+
+        if (write) {
+            double t = MPI_Wtime();
+            grid.write("output_" + to_string(m) + "x" + to_string(n) + ".bin");
+            res.write_ms = (MPI_Wtime() - t) * 1000;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &res.ms, 1, MPI_DOUBLE, MPI_MAX, d.cart);
+    MPI_Allreduce(MPI_IN_PLACE, &res.wait_ms, 1, MPI_DOUBLE, MPI_MAX, d.cart);
+    MPI_Allreduce(MPI_IN_PLACE, &res.write_ms, 1, MPI_DOUBLE, MPI_MAX, d.cart);
+    MPI_Comm_free(&d.cart);
+    return res;
+}
+
+// Масштабирование на 1, 2, 4, ... процессах (и на всех): сильное - сетка
+// m x n, слабое - m * p строк на p процессах; по iters итераций без
+// проверки сходимости. Процессы с номером >= p в прогоне не участвуют.
+void run_scaling(int m, int n, int iters, bool twoD) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    vector<int> counts;
+    for (int p = 1; p < size; p *= 2) {
+        counts.push_back(p);
+    }
+    counts.push_back(size);
+
+    double strong1 = 0.0, weak1 = 0.0;
+    for (int p : counts) {
+        MPI_Comm sub;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < p ? 0 : MPI_UNDEFINED, rank, &sub);
+        if (sub != MPI_COMM_NULL) {
+            mpi_result strong = solve(sub, m, n, iters, 0.0, twoD, false);
+            mpi_result weak = solve(sub, m * p, n, iters, 0.0, twoD, false);
+            if (p == 1) {
+                strong1 = strong.ms;
+                weak1 = weak.ms;
+            }
+            if (rank == 0) {
+                printf("p = %3d  strong %dx%d: %9.1f ms, speedup %5.2f, efficiency %4.2f, halo wait %7.1f ms"
+                       "  |  weak %dx%d: %9.1f ms, efficiency %4.2f\n",
+                       p, m, n, strong.ms, strong1 / strong.ms, strong1 / strong.ms / p, strong.wait_ms,
+                       m * p, n, weak.ms, weak1 / weak.ms);
+            }
+            MPI_Comm_free(&sub);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+}
+
+
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Получаем и парсим опции (как в cpu_multicore)
+    opt::options_description desc('\0');
+    desc.add_options()
+        ("epsilon", opt::value<double>())
+        ("m", opt::value<int>())
+        ("n", opt::value<int>())
+        ("iter", opt::value<int>())
+        ("decomp", opt::value<string>())      // rows | 2d
+        ("scaling", opt::bool_switch())       // сильное и слабое масштабирование
+        ("scaling-iters", opt::value<int>())  // итераций на прогон масштабирования
+    ;
+
+    opt::variables_map vm;
+    opt::store(opt::parse_command_line(argc, argv, desc), vm);
+    opt::notify(vm);
+
+    const double epsilonMin = (vm.count("epsilon")) ? vm["epsilon"].as<double>() : 1e-6;
+    const int m = (vm.count("m")) ? vm["m"].as<int>() : 1024;
+    const int n = (vm.count("n")) ? vm["n"].as<int>() : m;
+    const int iterMax = (vm.count("iter")) ? vm["iter"].as<int>() : 1e6;
+    const string decomp = (vm.count("decomp")) ? vm["decomp"].as<string>() : "rows";
+    const bool twoD = (decomp == "2d");
+    if (!twoD && decomp != "rows") {
+        if (rank == 0) {
+            cerr << "unknown decomposition '" << decomp << "' (rows|2d)\n";
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    if (vm["scaling"].as<bool>()) {
+        const int iters = (vm.count("scaling-iters")) ? vm["scaling-iters"].as<int>() : 1000;
+        if (rank == 0) {
+            cout << "\n=== SCALING (" << decomp << ", " << iters << " iterations per run) ===\n";
+        }
+        run_scaling(m, n, iters, twoD);
+    }
+    else {
+        mpi_result res = solve(MPI_COMM_WORLD, m, n, iterMax, epsilonMin, twoD, true);
+        if (rank == 0) {
+            cout << "\n=== MPI: " << size << " processes, " << decomp << " decomposition ===\n";
+            cout << "Matrix size: " << m << " x " << n << "\n";
+            cout << "Iterations: " << iterMax << ", Epsilon: " << epsilonMin << "\n";
+            if (res.epsilon < epsilonMin) {
+                cout << "\nDone in " << res.iterations << " iterations!\n";
+            }
+            else {
+                cout << "\nIterations limit exceeded!\n";
+            }
+            cout << "Elapsed time: " << res.ms << " ms (halo wait " << res.wait_ms << " ms)\n";
+            double mb = (double)m * n * sizeof(double) / 1e6;
+            cout << "MPI-IO write: " << mb << " MB in " << res.write_ms << " ms, "
+                 << mb * 1e3 / max(res.write_ms, 1e-3) << " MB/s\n";
+            cout << "Results saved in output_" << m << "x" << n << ".bin\n";
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,425 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "jacobi.hpp"
+#include "stencil_simd.hpp"
+#include "output.hpp"
+#include "checkpoint.hpp"
+#include "backend.hpp"
+#include "bench.h"
+
+// Общая часть cpu_host.cpp и cpu_multicore.cpp: опции, прогон сеток,
+// сравнения (--check-every, тайлы, --simd, --backend-scaling) и сводки.
+// Сами файлы задают только то, чем отличаются: вес центра в шаблоне,
+// начальную сетку и исходный цикл с #pragma acc.
+
+struct jacobi_task {
+    const char *tag;  // метка в сводке bench.h
+    double center;    // вес A[i][j] в шаблоне (stencil_params)
+    void (*initialize)(double *A, double *Anew, int m, int n);
+    // исходный цикл (--backend acc), аргументы и итог - как у iterate_backend
+    int (*iterate)(double *&A, double *&Anew, const stencil_params& p, int iterMax, double epsilonMin,
+                   double& epsilon, const sweep_hook& on_sweep, int first);
+};
+
+class jacobi_driver {
+public:
+    explicit jacobi_driver(const jacobi_task& task) : task(task) {}
+
+    jacobi_driver(const jacobi_driver&) = delete;
+    jacobi_driver& operator=(const jacobi_driver&) = delete;
+
+    // неверные опции и ошибки расчёта - сообщение в stderr и код 1
+    int run(int argc, char *argv[]) {
+        try {
+            return run_options(argc, argv);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+private:
+    int run_options(int argc, char *argv[]) {
+        namespace opt = boost::program_options;
+
+        // Получаем и парсим опции (по условиям)
+        opt::options_description desc('\0');
+        desc.add_options()
+            ("epsilon", opt::value<double>())
+            ("m", opt::value<int>())
+            ("n", opt::value<int>())
+            ("iter", opt::value<int>())
+            ("tiled", opt::bool_switch())       // сравнить с расчётом на временных блоках (jacobi.hpp)
+            ("tile-rows", opt::value<int>()) // размеры блока для --tiled
+            ("tile-cols", opt::value<int>())
+            ("tsteps", opt::value<int>())
+            ("check-every", opt::value<int>()) // epsilon раз в K итераций
+            ("predict", opt::bool_switch())     // предсказывать итерацию сходимости
+            ("method", opt::value<std::string>())    // jacobi | rbgs | sor | mg
+            ("omega", opt::value<double>())     // параметр релаксации для sor
+            ("output", opt::value<std::string>())    // text | binary | zstd | lz4
+            ("checkpoint", opt::value<int>())   // контрольная точка раз в K итераций
+            ("resume", opt::bool_switch())      // продолжить с последней контрольной точки
+            ("simd", opt::bool_switch())        // сравнить float/double, скалярный/векторный шаблон
+            ("backend", opt::value<std::string>())   // acc | omp | threads | par
+            ("backend-scaling", opt::value<std::vector<int>>()->multitoken()->implicit_value(std::vector<int>(), ""))
+                                                // сравнить исполнители на заданном числе потоков
+            ("sizes", opt::value<std::vector<int>>()->multitoken()) // размеры сеток вместо встроенных
+            ("warmup", opt::value<int>())       // прогревочных прогонов в --backend-scaling
+            ("reps", opt::value<int>())         // прогонов в замере (медиана, p95)
+            ("json", opt::value<std::string>())      // сводка замеров в JSON
+            ("csv", opt::value<std::string>())       // и в CSV
+            ("perf", opt::bool_switch())        // аппаратные счётчики и roofline (perfcount.h)
+        ;
+
+        opt::variables_map vm;
+        opt::store(opt::parse_command_line(argc, argv, desc), vm);
+        opt::notify(vm);
+
+        epsilonMin = (vm.count("epsilon")) ? vm["epsilon"].as<double>() : 1e-6;
+        const int m = (vm.count("m")) ? vm["m"].as<int>() : -1;
+        const int n = (vm.count("n")) ? vm["n"].as<int>() : -1;
+        iterMax = (vm.count("iter")) ? vm["iter"].as<int>() : 1e6;
+
+        tile.rows = (vm.count("tile-rows")) ? vm["tile-rows"].as<int>() : tile.rows;
+        tile.cols = (vm.count("tile-cols")) ? vm["tile-cols"].as<int>() : tile.cols;
+        tile.steps = (vm.count("tsteps")) ? vm["tsteps"].as<int>() : tile.steps;
+        if (tile.rows < 1 || tile.cols < 1 || tile.steps < 1) {
+            throw std::invalid_argument("--tile-rows, --tile-cols and --tsteps must be at least 1");
+        }
+        tiled = vm["tiled"].as<bool>();
+
+        check.every = (vm.count("check-every")) ? vm["check-every"].as<int>() : 1;
+        check.predict = vm["predict"].as<bool>();
+
+        method = parse_method((vm.count("method")) ? vm["method"].as<std::string>() : "jacobi");
+        omega = (vm.count("omega")) ? vm["omega"].as<double>() : 0.0; // 0 - оптимальный для сетки
+        simd = vm["simd"].as<bool>();
+        perf_enable(vm["perf"].as<bool>());
+
+        ckpt_policy.every = (vm.count("checkpoint")) ? vm["checkpoint"].as<int>() : 0;
+        ckpt_policy.resume = vm["resume"].as<bool>();
+        if ((ckpt_policy.every > 0 || ckpt_policy.resume) && (method != solver_method::jacobi || check.every > 1)) {
+            throw std::invalid_argument("--checkpoint/--resume work with the default jacobi loop only");
+        }
+
+        backend = (vm.count("backend")) ? parse_backend(vm["backend"].as<std::string>()) : default_backend();
+        if (vm.count("backend-scaling")) {
+            scaling = vm["backend-scaling"].as<std::vector<int>>();
+            if (scaling.empty()) { // по умолчанию 1, 2, 4, ... и все ядра
+                const int cores = std::max(1u, std::thread::hardware_concurrency());
+                for (int t = 1; t < cores; t *= 2) {
+                    scaling.push_back(t);
+                }
+                scaling.push_back(cores);
+            }
+        }
+        results_writer.set_format(parse_result_format((vm.count("output")) ? vm["output"].as<std::string>() : "text"));
+
+        std::vector<int> presets = { 10, 13, 128, 256, 512, 1024 };
+        if (vm.count("sizes")) {
+            presets = vm["sizes"].as<std::vector<int>>();
+        }
+        bench_config_init(&bench, nullptr, 0, nullptr, 0); // потоки - из --backend-scaling
+        bench.warmup = (vm.count("warmup")) ? vm["warmup"].as<int>() : 0;
+        bench.reps = std::max(1, std::min(BENCH_MAX_REPS, (vm.count("reps")) ? vm["reps"].as<int>() : 1));
+        bench.json = (vm.count("json")) ? vm["json"].as<std::string>().c_str() : nullptr;
+        bench.csv = (vm.count("csv")) ? vm["csv"].as<std::string>().c_str() : nullptr;
+
+        // Инициализируем и выполняем вычисления
+        if (m == -1 || n == -1) {
+            std::cout << "\n=== RUNNING DEFAULT PRESETS... ===\n";
+            for (int size : presets) {
+                run_grid(size, size);
+            }
+        }
+        else {
+            std::cout << "\n=== RUNNING USER PRESET... ===\n";
+            run_grid(m, n);
+        }
+
+        bool written = results_writer.finish();
+        if (report.count > 0) {
+            bench_finish(&bench, &report, task.tag);
+        }
+        if (!written) {
+            return 1;
+        }
+        std::cout << "Results saved in output.txt files.\n";
+        return 0;
+    }
+
+    static constexpr double thau = 0.25;
+
+    jacobi_task task;
+
+    // опции
+    double epsilonMin = 1e-6;
+    int iterMax = 1e6;
+    bool tiled = false;
+    tile_shape tile;
+    check_policy check;
+    solver_method method = solver_method::jacobi;
+    double omega = 0.0;
+    bool simd = false;
+    checkpoint_policy ckpt_policy;
+    backend_kind backend = backend_kind::acc;
+    std::vector<int> scaling;
+
+    int last_iterations = 0; // сколько итераций (проходов по сетке) сделал последний iterate()
+    check_stats last_check_stats;
+    result_writer results_writer; // итоговые сетки пишутся в фоне (output.hpp)
+    bench_config_t bench;          // повторы и сводка --backend-scaling (bench.h)
+    bench_report_t report;
+
+    stencil_params params(int m, int n) const {
+        return stencil_params{ m, n, thau, task.center };
+    }
+
+    // одна сетка m x n: расчёт, запись результата и выбранные сравнения
+    void run_grid(int m, int n) {
+        double *A = new double[n*m];
+        double *Anew = new double[n*m];
+        task.initialize(A, Anew, m, n);
+
+        std::cout << "Matrix size: " << m << " x " << n << "\n";
+        std::cout << "Iterations: " << iterMax << ", Epsilon: " << epsilonMin << "\n";
+
+        double w = (omega > 0.0) ? omega : sor_optimal_omega(m, n);
+        print_method(method, w);
+        auto results = iterate(A, Anew, m, n, w);
+        std::cout << "Elapsed time: " << results << " ms\n";
+        print_backend_perf(backend, m, n, last_iterations, results);
+        if (method == solver_method::jacobi) {
+            if (check.every > 1) {
+                run_check_reference(m, n, results);
+            }
+            if (tiled) {
+                run_tiled(m, n, results);
+            }
+        }
+        if (simd) {
+            run_simd(m, n);
+        }
+        if (!scaling.empty()) {
+            run_backend_scaling(m, n);
+        }
+        std::cout << "------\n\n";
+
+        delete[] A;
+        delete[] Anew;
+    }
+
+    long long iterate(double *A, double *Anew, int m, int n, double w) {
+        double *snapshot = (check.every > 1) ? new double[n*m] : nullptr;
+        std::unique_ptr<checkpointer> ckpt;
+        if (ckpt_policy.every > 0 || ckpt_policy.resume) {
+            ckpt = std::make_unique<checkpointer>(m, n, ckpt_policy);
+        }
+        auto start = std::chrono::steady_clock::now();
+
+        double epsilon = 1.0;
+        int sweeps;
+        if (method != solver_method::jacobi) {
+            // красно-чёрный Гаусс-Зейдель / SOR / многосетка (jacobi.hpp), сетка остаётся в A
+            sweeps = iterate_method(A, Anew, params(m, n), method, w, iterMax, epsilonMin, epsilon);
+        }
+        else if (check.every > 1) {
+            // epsilon - раз в check.every итераций (jacobi.hpp), результат тот же
+            last_check_stats = check_stats();
+            sweeps = iterate_checked(A, Anew, params(m, n), iterMax, epsilonMin, check, snapshot, epsilon,
+                                     last_check_stats);
+        }
+        else {
+            // исходный цикл (acc) или omp / std::thread / std::execution::par (backend.hpp), результат тот же
+            int first = (ckpt) ? ckpt->restore(A, epsilon, iterMax) : 0; // --resume: с сохранённой итерации
+            sweep_hook on_sweep;
+            if (ckpt) {
+                on_sweep = [&](const double *grid, int iteration, double eps) { ckpt->step(grid, iteration, eps); };
+            }
+            if (backend == backend_kind::acc) {
+                sweeps = task.iterate(A, Anew, params(m, n), iterMax, epsilonMin, epsilon, on_sweep, first);
+            }
+            else {
+                sweeps = iterate_backend(backend, A, Anew, params(m, n), iterMax, epsilonMin, epsilon, 0, on_sweep,
+                                         first);
+            }
+        }
+        if (epsilon < epsilonMin) {
+            std::cout << "\nDone in " << sweeps << " iterations!\n";
+        }
+        else {
+            std::cout << "\nIterations limit exceeded!\n";
+        }
+        last_iterations = sweeps;
+
+        auto end = std::chrono::steady_clock::now();
+        auto timediff = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        if (ckpt) {
+            ckpt->report();
+        }
+
+        // Записываем матрицу в файл (в фоновом потоке, время записи - в отчёте results_writer)
+        results_writer.submit(A, m, n);
+
+        delete[] snapshot;
+        return timediff.count();
+    }
+
+    // Для --check-every: тот же расчёт с проверкой на каждой итерации, чтобы
+    // показать выигрыш от редких проверок. Файл не пишется.
+    void run_check_reference(int m, int n, long long checked_ms) {
+        double *A = new double[n*m];
+        double *Anew = new double[n*m];
+        task.initialize(A, Anew, m, n);
+
+        double epsilon;
+        check_stats stats;
+        auto start = std::chrono::steady_clock::now();
+        iterate_checked(A, Anew, params(m, n), iterMax, epsilonMin, check_policy(), nullptr, epsilon, stats);
+        auto end = std::chrono::steady_clock::now();
+        double every_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::cout << "Checks: " << last_check_stats.checks << ", re-run sweeps: " << last_check_stats.rerun
+                  << ", predicted segments: " << last_check_stats.predicted << "\n";
+        std::cout << "Check every iteration elapsed time: " << every_ms << " ms\n";
+        std::cout << "Check every " << check.every << (check.predict ? " (predict)" : "") << " speedup: "
+                  << every_ms / std::max(checked_ms, 1LL) << "\n";
+
+        delete[] A;
+        delete[] Anew;
+    }
+
+    // Тот же расчёт на временных блоках (jacobi.hpp) - для сравнения скорости
+    // с iterate(). Файл не пишется, сетка та же.
+    void run_tiled(int m, int n, long long current_ms) {
+        double *A = new double[n*m];
+        double *Anew = new double[n*m];
+        task.initialize(A, Anew, m, n);
+
+        double epsilon;
+        auto start = std::chrono::steady_clock::now();
+        int sweeps = iterate_tiled(A, Anew, params(m, n), tile, iterMax, epsilonMin, epsilon);
+        auto end = std::chrono::steady_clock::now();
+        double tiled_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        double cells = (double)(m - 2) * (n - 2);
+        double tiled_rate = cells * sweeps / (tiled_ms * 1e-3);
+        double current_rate = cells * last_iterations / (std::max(current_ms, 1LL) * 1e-3);
+        std::cout << "Tiled (" << tile.rows << "x" << tile.cols << ", " << tile.steps << " steps): "
+                  << sweeps << " iterations, epsilon " << epsilon << "\n";
+        std::cout << "Tiled elapsed time: " << tiled_ms << " ms\n";
+        std::cout << "Cell-updates/s: tiled " << tiled_rate << ", current " << current_rate
+                  << " (x" << tiled_rate / current_rate << ")\n";
+
+        delete[] A;
+        delete[] Anew;
+    }
+
+    // --simd: тот же расчёт на выровненных строках (stencil_simd.hpp) в double и
+    // float, скалярно и векторами; расхождение - с double без векторов.
+    // Файл не пишется.
+    void run_simd(int m, int n) {
+        double *A = new double[n*m];
+        double *Anew = new double[n*m];
+        task.initialize(A, Anew, m, n);
+
+        typedef int (*kernel_t)(const double*, double*, const stencil_params&, int, double, double&);
+        struct variant {
+            const char *type;
+            int width;
+            kernel_t kernel;
+        };
+        const variant variants[] = {
+            { "double", 1, iterate_padded<double, 1> },
+            { "double", simd_width<double>(), iterate_padded<double, simd_width<double>()> },
+            { "float", 1, iterate_padded<float, 1> },
+            { "float", simd_width<float>(), iterate_padded<float, simd_width<float>()> },
+        };
+
+        std::vector<double> reference(n*m), result(n*m);
+        const double cells = (double)(m - 2) * (n - 2);
+        for (const variant& v : variants) {
+            double epsilon;
+            auto start = std::chrono::steady_clock::now();
+            int sweeps = v.kernel(A, result.data(), params(m, n), iterMax, epsilonMin, epsilon);
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+            if (&v == variants) {
+                reference = result;
+            }
+            double diff = 0.0;
+            for (int k = 0; k < n*m; k++) {
+                diff = std::max(diff, std::fabs(result[k] - reference[k]));
+            }
+            std::cout << "Kernel " << v.type << " x" << v.width << ": " << sweeps << " iterations, " << ms << " ms, "
+                      << cells * sweeps / (ms * 1e-3) << " cell-updates/s, max diff " << diff << "\n";
+        }
+
+        delete[] A;
+        delete[] Anew;
+    }
+
+    // --backend-scaling: один и тот же расчёт на каждом исполнителе при
+    // разном числе потоков; сетка сравнивается с первым прогоном. Файл не пишется.
+    // Время - медиана --reps прогонов после --warmup, всё идёт в сводку bench.h.
+    void run_backend_scaling(int m, int n) {
+        std::vector<double> reference;
+        for (backend_kind kind : { backend_kind::omp, backend_kind::threads, backend_kind::par }) {
+            double base_ms = 0.0;
+            for (int t : scaling) {
+                double *A = new double[n*m];
+                double *Anew = new double[n*m];
+                int sweeps = 0;
+                auto run = [&]() {
+                    task.initialize(A, Anew, m, n);
+                    double epsilon;
+                    auto start = std::chrono::steady_clock::now();
+                    sweeps = iterate_backend(kind, A, Anew, params(m, n), iterMax, epsilonMin, epsilon, t);
+                    auto end = std::chrono::steady_clock::now();
+                    return std::chrono::duration<double, std::milli>(end - start).count();
+                };
+                bench_stats_t st;
+                BENCH_MEASURE(&bench, st, run());
+                bench_record(&report, backend_name(kind), NULL, m, t, st);
+                double ms = st.median;
+                base_ms = (t == scaling[0]) ? ms : base_ms;
+
+                if (reference.empty()) {
+                    reference.assign(A, A + n*m);
+                }
+                bool identical = std::equal(reference.begin(), reference.end(), A);
+                std::cout << "Backend " << backend_name(kind) << ", " << t << " threads: " << sweeps
+                          << " iterations, " << ms << " ms, speedup " << base_ms / ms
+                          << (identical ? ", identical" : ", DIFFERENT") << "\n";
+                print_backend_perf(kind, m, n, sweeps, ms);
+
+                delete[] A;
+                delete[] Anew;
+            }
+        }
+    }
+
+    static void print_method(solver_method method, double omega) {
+        const char *names[] = { "jacobi", "rbgs", "sor", "mg" };
+        std::cout << "Method: " << names[(int)method];
+        if (method == solver_method::sor) {
+            std::cout << " (omega " << omega << ")";
+        }
+        std::cout << "\n";
+    }
+};
@@ -0,0 +1,587 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfcount.h"
+
+// Общие ядра для cpu_host.cpp и cpu_multicore.cpp. Шаблон у них один:
+// Anew = thau * (center * A + 4 соседа), где center = 1 в cpu_host и
+// center = 0 в cpu_multicore, поэтому ядра принимают его параметром.
+
+struct stencil_params {
+    int m, n;
+    double thau;
+    double center;
+};
+
+// одна строка шаблона: out[j] для j из [lo, hi), up/mid/down - строки i-1, i, i+1
+inline void stencil_row(double *out, const double *up, const double *mid, const double *down, int lo, int hi,
+                        const stencil_params& p) {
+    const double thau = p.thau, center = p.center;
+    #pragma omp simd
+    for (int j = lo; j < hi; j++) {
+        out[j] = thau * (center * mid[j] + mid[j-1] + mid[j+1] + up[j] + down[j]);
+    }
+}
+
+// то же и max |out - mid| по строке
+inline double stencil_row_eps(double *out, const double *up, const double *mid, const double *down, int lo, int hi,
+                              const stencil_params& p) {
+    const double thau = p.thau, center = p.center;
+    double eps = 0.0;
+    #pragma omp simd reduction(max:eps)
+    for (int j = lo; j < hi; j++) {
+        out[j] = thau * (center * mid[j] + mid[j-1] + mid[j+1] + up[j] + down[j]);
+        eps = std::max(eps, std::fabs(out[j] - mid[j]));
+    }
+    return eps;
+}
+
+
+
+// Один проход Якоби по всей сетке без вычисления epsilon: без редукции
+// между потоками, и строка векторизуется целиком
+inline void jacobi_sweep(const double *A, double *Anew, const stencil_params& p) {
+    const int m = p.m, n = p.n;
+    #pragma omp parallel for schedule(static)
+    for (int i = 1; i < m - 1; i++) {
+        stencil_row(Anew + (size_t)i*n, A + (size_t)(i-1)*n, A + (size_t)i*n, A + (size_t)(i+1)*n, 1, n - 1, p);
+    }
+}
+
+// то же, но с max |Anew - A| (как epsilon в iterate()); region - участок
+// perfcount.h, в котором каждый поток считает свою часть строк
+inline double jacobi_sweep_eps(const double *A, double *Anew, const stencil_params& p, int region = -1) {
+    const int m = p.m, n = p.n;
+    double epsilon = 0.0;
+    #pragma omp parallel reduction(max:epsilon)
+    {
+        PERF_BEGIN(region);
+        #pragma omp for schedule(static) nowait
+        for (int i = 1; i < m - 1; i++) {
+            double eps = stencil_row_eps(Anew + (size_t)i*n, A + (size_t)(i-1)*n, A + (size_t)i*n,
+                                         A + (size_t)(i+1)*n, 1, n - 1, p);
+            epsilon = std::max(epsilon, eps);
+        }
+        PERF_END(region);
+    }
+    return epsilon;
+}
+
+inline void copy_grid(const double *from, double *to, const stencil_params& p) {
+    #pragma omp parallel for schedule(static) // то же разбиение строк, что и в проходах
+    for (int i = 0; i < p.m; i++) {
+        std::copy(from + (size_t)i*p.n, from + (size_t)(i+1)*p.n, to + (size_t)i*p.n);
+    }
+}
+
+
+
+// === Проверка сходимости раз в K итераций ===
+//
+// epsilon считается только на каждом every-м проходе, остальные проходы -
+// jacobi_sweep без редукции. Перед каждым отрезком сетка копируется в
+// snapshot; если проверка в конце отрезка показала сходимость, отрезок
+// пересчитывается из snapshot с проверкой на каждом проходе, так что
+// число итераций и итоговая сетка - ровно как при every = 1.
+//
+// predict: по двум последним проверкам оценивается скорость убывания
+// epsilon (epsilon ~ C * r^k) и, если порог ожидается раньше конца
+// отрезка, отрезок укорачивается так, чтобы проверка пришлась чуть до
+// него. Отрезки у порога становятся всё короче, и повторять приходится
+// несколько проходов, а не every.
+
+struct check_policy {
+    int every = 1;
+    bool predict = false;
+};
+
+struct check_stats {
+    int checks = 0;    // проходов с вычислением epsilon
+    int rerun = 0;     // проходов, сделанных повторно после сходимости
+    int predicted = 0; // отрезков, укороченных предсказателем
+};
+
+// Возвращает число проходов; итоговая сетка - в A, snapshot - буфер m*n
+inline int iterate_checked(double *&A, double *&Anew, const stencil_params& p, int iterMax, double epsilonMin,
+                           const check_policy& policy, double *snapshot, double& epsilon, check_stats& stats) {
+    int done = 0;
+    double prev_eps = -1.0, last_eps = -1.0;
+    int prev_at = 0, last_at = 0;
+    epsilon = 1.0;
+
+    while (done < iterMax) {
+        int seg = std::min(std::max(1, policy.every), iterMax - done);
+        if (policy.predict && prev_eps > 0.0 && last_eps > 0.0 && last_eps < prev_eps) {
+            double rate = std::log(last_eps / prev_eps) / (last_at - prev_at); // < 0
+            double need = std::ceil(std::log(epsilonMin / last_eps) / rate);
+            if (need >= 1.0 && need <= seg) {
+                // проверка чуть раньше ожидаемого порога: у самого порога
+                // отрезки становятся короткими, а повтор - ненужным
+                seg = std::max(1, (int)need - (int)need / 16 - 1);
+                stats.predicted++;
+            }
+        }
+
+        if (seg > 1) {
+            copy_grid(A, snapshot, p);
+        }
+        for (int k = 0; k < seg - 1; k++) {
+            jacobi_sweep(A, Anew, p);
+            std::swap(A, Anew);
+        }
+        epsilon = jacobi_sweep_eps(A, Anew, p);
+        std::swap(A, Anew);
+        stats.checks++;
+        done += seg;
+
+        if (epsilon < epsilonMin) {
+            if (seg > 1) {
+                // порог мог быть пройден раньше - повторяем отрезок с проверкой каждого прохода
+                copy_grid(snapshot, A, p);
+                done -= seg;
+                for (int k = 0; k < seg; k++) {
+                    epsilon = jacobi_sweep_eps(A, Anew, p);
+                    std::swap(A, Anew);
+                    done++;
+                    stats.rerun++;
+                    if (epsilon < epsilonMin) {
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+
+        prev_eps = last_eps;
+        prev_at = last_at;
+        last_eps = epsilon;
+        last_at = done;
+    }
+    return done;
+}
+
+
+
+// === Временные блоки (temporal blocking) ===
+//
+// Обычный iterate() на каждой итерации прогоняет через память всю сетку
+// (16 МБ при 1024^2). Здесь сетка режется на тайлы, и каждый тайл делает
+// сразу steps шагов по времени в своём буфере, который помещается в кэш.
+// Тайлы перекрываются (ghost zone ширины steps): чтобы получить свои
+// клетки через steps шагов, тайл пересчитывает и полосу соседей, каждый
+// шаг на одну клетку уже. Тайлы независимы, поэтому считаются параллельно,
+// а память читается и пишется один раз на steps итераций.
+
+struct tile_shape {
+    int rows = 64;
+    int cols = 256;
+    int steps = 8;
+};
+
+// steps шагов из A в Anew (A не меняется). step_eps[s] - максимум
+// |изменения| на шаге s по всей сетке, ровно как epsilon в iterate().
+inline void tiled_block(const double *A, double *Anew, const stencil_params& p, const tile_shape& tile,
+                        int steps, double *step_eps) {
+    const int m = p.m, n = p.n;
+    const int tiles_i = (m - 2 + tile.rows - 1) / tile.rows;
+    const int tiles_j = (n - 2 + tile.cols - 1) / tile.cols;
+    for (int s = 0; s < steps; s++) {
+        step_eps[s] = 0.0;
+    }
+
+    #pragma omp parallel
+    {
+        std::vector<double> buf[2];
+        buf[0].resize((size_t)(tile.rows + 2*steps) * (tile.cols + 2*steps));
+        buf[1].resize(buf[0].size());
+
+        #pragma omp for collapse(2) schedule(dynamic) reduction(max:step_eps[:steps])
+        for (int ti = 0; ti < tiles_i; ti++) {
+            for (int tj = 0; tj < tiles_j; tj++) {
+                // свои клетки тайла [i0, i1) x [j0, j1) и область с перекрытием
+                const int i0 = 1 + ti*tile.rows, i1 = std::min(m - 1, i0 + tile.rows);
+                const int j0 = 1 + tj*tile.cols, j1 = std::min(n - 1, j0 + tile.cols);
+                const int r0 = std::max(0, i0 - steps), r1 = std::min(m, i1 + steps);
+                const int c0 = std::max(0, j0 - steps), c1 = std::min(n, j1 + steps);
+                const int w = c1 - c0;
+
+                for (int i = r0; i < r1; i++) {
+                    std::copy(A + (size_t)i*n + c0, A + (size_t)i*n + c1, buf[0].data() + (size_t)(i - r0)*w);
+                    std::copy(A + (size_t)i*n + c0, A + (size_t)i*n + c1, buf[1].data() + (size_t)(i - r0)*w);
+                }
+
+                // в буфере строка i хранится под номером i - r0, столбец j - под j - c0
+                for (int s = 1; s <= steps; s++) {
+                    const double *cur = buf[(s - 1) & 1].data();
+                    double *next = buf[s & 1].data();
+
+                    // ещё нужная область: свои клетки плюс (steps - s) вокруг,
+                    // граница сетки не обновляется
+                    const int u0 = std::max(1, i0 - (steps - s)), u1 = std::min(m - 1, i1 + (steps - s));
+                    const int v0 = std::max(1, j0 - (steps - s)), v1 = std::min(n - 1, j1 + (steps - s));
+                    double eps = 0.0;
+                    for (int i = u0; i < u1; i++) {
+                        double *out = next + (ptrdiff_t)(i - r0)*w - c0; // индекс - глобальный столбец j
+                        const double *mid = cur + (ptrdiff_t)(i - r0)*w - c0;
+                        if (i < i0 || i >= i1) {
+                            stencil_row(out, mid - w, mid, mid + w, v0, v1, p);
+                            continue;
+                        }
+                        // epsilon - только по своим клеткам, в том же проходе
+                        stencil_row(out, mid - w, mid, mid + w, v0, j0, p);
+                        eps = std::max(eps, stencil_row_eps(out, mid - w, mid, mid + w, j0, j1, p));
+                        stencil_row(out, mid - w, mid, mid + w, j1, v1, p);
+                    }
+                    step_eps[s - 1] = std::max(step_eps[s - 1], eps);
+                }
+
+                const double *result = buf[steps & 1].data();
+                for (int i = i0; i < i1; i++) {
+                    std::copy(result + (size_t)(i - r0)*w + (j0 - c0), result + (size_t)(i - r0)*w + (j1 - c0),
+                              Anew + (size_t)i*n + j0);
+                }
+            }
+        }
+    }
+}
+
+// Итерации блоками по tile.steps до epsilon < epsilonMin или iterMax.
+// Если сошлось посреди блока, блок пересчитывается из A ровно до этого
+// шага - число итераций и сетка те же, что у обычного iterate().
+// Возвращает число выполненных шагов; итоговая сетка - в A.
+inline int iterate_tiled(double *&A, double *&Anew, const stencil_params& p, const tile_shape& tile,
+                         int iterMax, double epsilonMin, double& epsilon) {
+    std::vector<double> step_eps(tile.steps);
+    int done = 0;
+    epsilon = 1.0;
+    while (done < iterMax) {
+        int steps = std::min(tile.steps, iterMax - done);
+        tiled_block(A, Anew, p, tile, steps, step_eps.data());
+
+        int hit = -1;
+        for (int s = 0; s < steps && hit < 0; s++) {
+            if (step_eps[s] < epsilonMin) {
+                hit = s;
+            }
+        }
+        if (hit >= 0 && hit < steps - 1) {
+            steps = hit + 1;
+            tiled_block(A, Anew, p, tile, steps, step_eps.data());
+        }
+
+        std::swap(A, Anew);
+        done += steps;
+        epsilon = step_eps[steps - 1];
+        if (epsilon < epsilonMin) {
+            break;
+        }
+    }
+    return done;
+}
+
+
+
+// === Другие методы: красно-чёрный Гаусс-Зейдель / SOR и многосетка ===
+//
+// Уравнение, неподвижную точку которого ищет Якоби, в общем виде:
+//     sigma * u + beta * (4u - сумма соседей) = f,
+// где beta = thau, sigma = 1 - thau * center - 4 * thau (для cpu_multicore
+// sigma = 0 - это уравнение Лапласа), f = 0 на мелкой сетке.
+// Граница - та же, что задаёт initialize(), и не меняется.
+
+enum class solver_method { jacobi, rbgs, sor, mg };
+
+inline solver_method parse_method(const std::string& name) {
+    if (name == "jacobi") return solver_method::jacobi;
+    if (name == "rbgs") return solver_method::rbgs;
+    if (name == "sor") return solver_method::sor;
+    if (name == "mg") return solver_method::mg;
+    throw std::invalid_argument("unknown method '" + name + "' (jacobi|rbgs|sor|mg)");
+}
+
+// оптимальный omega для Лапласа на сетке m x n
+inline double sor_optimal_omega(int m, int n) {
+    return 2.0 / (1.0 + std::sin(M_PI / (std::max(m, n) - 1)));
+}
+
+// Полупроход по клеткам цвета color ((i + j) % 2 == color), на месте.
+// f == nullptr - нулевая правая часть. Возвращает max |изменения|.
+inline double rb_sor_half(double *u, const double *f, int m, int n, double sigma, double beta, double omega, int color) {
+    const double diag = sigma + 4.0*beta;
+    double change = 0.0;
+    #pragma omp parallel for schedule(static) reduction(max:change)
+    for (int i = 1; i < m - 1; i++) {
+        double *row = u + (size_t)i*n;
+        const double *up = row - n, *down = row + n;
+        for (int j = 1 + ((i + 1 + color) & 1); j < n - 1; j += 2) {
+            double rhs = (f ? f[(size_t)i*n + j] : 0.0) + beta * (row[j-1] + row[j+1] + up[j] + down[j]);
+            double delta = omega * (rhs / diag - row[j]);
+            row[j] += delta;
+            change = std::max(change, std::fabs(delta));
+        }
+    }
+    return change;
+}
+
+inline double rb_sor_sweep(double *u, const double *f, int m, int n, double sigma, double beta, double omega) {
+    double red = rb_sor_half(u, f, m, n, sigma, beta, omega, 0);
+    double black = rb_sor_half(u, f, m, n, sigma, beta, omega, 1);
+    return std::max(red, black);
+}
+
+// Геометрическая многосетка (V-цикл). Уровень l + 1 берёт каждую вторую
+// внутреннюю точку уровня l (внутренняя точка k грубой сетки - точка 2k
+// мелкой) плюс настоящую границу, так что подходят любые m и n, не только
+// 2^k + 1: при чётном числе внутренних точек последний шаг грубой сетки
+// вдвое короче. Поэтому у каждого уровня хранятся координаты линий сетки,
+// шаблон - вторая разность на неравномерной сетке (на мелкой сетке он
+// совпадает с обычным), продолжение - линейная интерполяция по
+// координатам, ограничение - сопряжённое к нему взвешивание (на
+// равномерной сетке - обычное полное взвешивание). Сглаживатель -
+// красно-чёрный Гаусс-Зейдель. Память под все уровни выделяется один раз.
+class multigrid {
+public:
+    multigrid(const stencil_params& p, int pre = 2, int post = 2) : pre_smooth(pre), post_smooth(post) {
+        sigma = 1.0 - p.thau * p.center - 4.0 * p.thau;
+        beta = p.thau;
+
+        level fine;
+        fine.m = p.m;
+        fine.n = p.n;
+        for (int i = 0; i < p.m; i++) {
+            fine.rows.pos.push_back(i);
+        }
+        for (int j = 0; j < p.n; j++) {
+            fine.cols.pos.push_back(j);
+        }
+        fine.r.assign((size_t)p.m * p.n, 0.0);
+        levels.push_back(std::move(fine));
+
+        while (true) {
+            level& last = levels.back();
+            int mi = (last.m - 2) / 2, ni = (last.n - 2) / 2; // внутренних точек на грубой сетке
+            if (mi < 3 || ni < 3) {
+                break;
+            }
+            level coarse;
+            coarse.m = mi + 2;
+            coarse.n = ni + 2;
+            coarse.rows.pos = coarsen(last.rows, mi);
+            coarse.cols.pos = coarsen(last.cols, ni);
+            coarse.u.assign((size_t)coarse.m * coarse.n, 0.0);
+            coarse.f.assign(coarse.u.size(), 0.0);
+            coarse.r.assign(coarse.u.size(), 0.0);
+            levels.push_back(std::move(coarse));
+        }
+
+        for (level& L : levels) {
+            L.rows.stencil();
+            L.cols.stencil();
+        }
+    }
+
+    int depth() const {
+        return (int)levels.size();
+    }
+
+    // один V-цикл для сетки A (граница A не меняется), возвращает max |изменения|
+    double vcycle(double *A, double *scratch) {
+        const level& fine = levels[0];
+        copy_grid(A, scratch, stencil_params{ fine.m, fine.n, 0.0, 0.0 });
+        cycle(0, A, nullptr);
+
+        double change = 0.0;
+        #pragma omp parallel for schedule(static) reduction(max:change)
+        for (size_t k = 0; k < (size_t)fine.m * fine.n; k++) {
+            change = std::max(change, std::fabs(A[k] - scratch[k]));
+        }
+        return change;
+    }
+
+private:
+    // одно направление сетки уровня
+    struct axis {
+        std::vector<double> pos;    // координаты линий (в шагах самой мелкой сетки)
+        std::vector<double> lo, hi; // коэффициенты второй разности при соседях k-1 и k+1
+        std::vector<int> coarse;    // грубая линия слева от линии k (или на ней)
+        std::vector<double> weight; // вес грубой линии coarse[k] + 1 при интерполяции
+
+        void stencil() {
+            int size = (int)pos.size();
+            lo.assign(size, 0.0);
+            hi.assign(size, 0.0);
+            for (int k = 1; k < size - 1; k++) {
+                double dl = pos[k] - pos[k-1], dr = pos[k+1] - pos[k];
+                lo[k] = 2.0 / ((dl + dr) * dl);
+                hi[k] = 2.0 / ((dl + dr) * dr);
+            }
+        }
+
+        // вклад линии k в грубую линию K при ограничении
+        double restrict_weight(int k, int K) const {
+            if (coarse[k] == K) return 1.0 - weight[k];
+            if (coarse[k] + 1 == K) return weight[k];
+            return 0.0;
+        }
+    };
+
+    struct level {
+        int m, n;
+        axis rows, cols;
+        std::vector<double> u, f, r; // на мелком уровне u - сама сетка A, f = 0
+    };
+
+    std::vector<level> levels;
+    int pre_smooth, post_smooth;
+    double sigma, beta;
+
+    // координаты грубой сетки с inner внутренними линиями; заполняет
+    // для мелкой сетки отображение на грубую
+    static std::vector<double> coarsen(axis& fine, int inner) {
+        int size = (int)fine.pos.size();
+        std::vector<double> pos(inner + 2);
+        for (int K = 0; K <= inner; K++) {
+            pos[K] = fine.pos[2*K];
+        }
+        pos[inner + 1] = fine.pos[size - 1];
+
+        fine.coarse.assign(size, 0);
+        fine.weight.assign(size, 0.0);
+        for (int k = 1; k < size - 1; k++) {
+            int K = k / 2;
+            fine.coarse[k] = K;
+            if (k & 1) {
+                fine.weight[k] = (fine.pos[k] - pos[K]) / (pos[K + 1] - pos[K]);
+            }
+        }
+        return pos;
+    }
+
+    void smooth(level& L, double *u, const double *f) {
+        const int m = L.m, n = L.n;
+        const axis &R = L.rows, &C = L.cols;
+        for (int color = 0; color < 2; color++) {
+            #pragma omp parallel for schedule(static)
+            for (int i = 1; i < m - 1; i++) {
+                double *row = u + (size_t)i*n;
+                const double *up = row - n, *down = row + n;
+                for (int j = 1 + ((i + 1 + color) & 1); j < n - 1; j += 2) {
+                    double diag = sigma + beta * (R.lo[i] + R.hi[i] + C.lo[j] + C.hi[j]);
+                    double rhs = (f ? f[(size_t)i*n + j] : 0.0)
+                        + beta * (C.lo[j]*row[j-1] + C.hi[j]*row[j+1] + R.lo[i]*up[j] + R.hi[i]*down[j]);
+                    row[j] = rhs / diag;
+                }
+            }
+        }
+    }
+
+    void cycle(int l, double *u, const double *f) {
+        level& L = levels[l];
+        if (l == depth() - 1) {
+            for (int k = 0; k < 50; k++) { // грубая сетка маленькая - просто сглаживаем до сходимости
+                smooth(L, u, f);
+            }
+            return;
+        }
+        for (int k = 0; k < pre_smooth; k++) {
+            smooth(L, u, f);
+        }
+
+        // невязка r = f - A u
+        const int m = L.m, n = L.n;
+        const axis &R = L.rows, &C = L.cols;
+        #pragma omp parallel for schedule(static)
+        for (int i = 1; i < m - 1; i++) {
+            for (int j = 1; j < n - 1; j++) {
+                size_t k = (size_t)i*n + j;
+                double Au = (sigma + beta * (R.lo[i] + R.hi[i] + C.lo[j] + C.hi[j])) * u[k]
+                    - beta * (C.lo[j]*u[k-1] + C.hi[j]*u[k+1] + R.lo[i]*u[k-n] + R.hi[i]*u[k+n]);
+                L.r[k] = (f ? f[k] : 0.0) - Au;
+            }
+        }
+
+        // взвешивание в правую часть грубой сетки, поправка с нуля
+        level& G = levels[l + 1];
+        const int gn = G.n;
+        #pragma omp parallel for schedule(static)
+        for (int I = 1; I < G.m - 1; I++) {
+            for (int J = 1; J < gn - 1; J++) {
+                double sum = 0.0, wsum = 0.0;
+                for (int i = std::max(2*I - 1, 1); i <= std::min(2*I + 1, m - 2); i++) {
+                    double wi = R.restrict_weight(i, I);
+                    for (int j = std::max(2*J - 1, 1); j <= std::min(2*J + 1, n - 2); j++) {
+                        double w = wi * C.restrict_weight(j, J);
+                        sum += w * L.r[(size_t)i*n + j];
+                        wsum += w;
+                    }
+                }
+                G.f[(size_t)I*gn + J] = sum / wsum;
+                G.u[(size_t)I*gn + J] = 0.0;
+            }
+        }
+        cycle(l + 1, G.u.data(), G.f.data());
+
+        // линейная интерполяция поправки; на границе грубой сетки она нулевая
+        const double *e = G.u.data();
+        auto ge = [&](int I, int J) {
+            return (I >= 1 && I < G.m - 1 && J >= 1 && J < gn - 1) ? e[(size_t)I*gn + J] : 0.0;
+        };
+        #pragma omp parallel for schedule(static)
+        for (int i = 1; i < m - 1; i++) {
+            int I = R.coarse[i];
+            double wi = R.weight[i];
+            for (int j = 1; j < n - 1; j++) {
+                int J = C.coarse[j];
+                double wj = C.weight[j];
+                u[(size_t)i*n + j] += (1.0 - wi) * ((1.0 - wj) * ge(I, J) + wj * ge(I, J + 1))
+                                    + wi * ((1.0 - wj) * ge(I + 1, J) + wj * ge(I + 1, J + 1));
+            }
+        }
+
+        for (int k = 0; k < post_smooth; k++) {
+            smooth(L, u, f);
+        }
+    }
+};
+
+// Решение методом method до epsilon < epsilonMin (max |изменения| за
+// итерацию: проход SOR или V-цикл) или iterMax итераций. Сетка - в A,
+// Anew - рабочий буфер. Возвращает число итераций.
+inline int iterate_method(double *A, double *Anew, const stencil_params& p, solver_method method, double omega,
+                          int iterMax, double epsilonMin, double& epsilon) {
+    const double sigma = 1.0 - p.thau * p.center - 4.0 * p.thau;
+    if (sigma < 0.0) {
+        // у cpu_host (center = 1) оператор знаконеопределён: Гаусс-Зейдель
+        // расходится, а на грубых сетках многосетки диагональ обращается в 0
+        throw std::invalid_argument("method needs 1 - thau * center - 4 * thau >= 0 (Laplace stencil)");
+    }
+    epsilon = 1.0;
+    if (method == solver_method::mg) {
+        multigrid mg(p);
+        for (int iter = 1; iter <= iterMax; iter++) {
+            epsilon = mg.vcycle(A, Anew);
+            if (epsilon < epsilonMin) {
+                return iter;
+            }
+        }
+        return iterMax;
+    }
+
+    if (method == solver_method::rbgs) {
+        omega = 1.0;
+    }
+    for (int iter = 1; iter <= iterMax; iter++) {
+        epsilon = rb_sor_sweep(A, nullptr, p.m, p.n, sigma, p.thau, omega);
+        if (epsilon < epsilonMin) {
+            return iter;
+        }
+    }
+    return iterMax;
+}
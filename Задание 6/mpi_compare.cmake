@@ -0,0 +1,23 @@
+# Тест cpu_mpi: запускает решение на NP процессах в каталоге WORKDIR и
+# сравнивает output_MxN.bin с эталоном однопроцессного cpu_multicore
+#   cmake -DMPIEXEC=... -DNUMPROC_FLAG=... -DNP=... -DPREFLAGS=... -DPOSTFLAGS=...
+#         -DEXE=cpu_mpi -DARGS="--m;64;..." -DWORKDIR=... -DREFERENCE=... -P mpi_compare.cmake
+
+file(REMOVE_RECURSE ${WORKDIR})
+file(MAKE_DIRECTORY ${WORKDIR})
+get_filename_component(result_name ${REFERENCE} NAME)
+
+execute_process(
+    COMMAND ${MPIEXEC} ${NUMPROC_FLAG} ${NP} ${PREFLAGS} ${EXE} ${POSTFLAGS} ${ARGS}
+    WORKING_DIRECTORY ${WORKDIR}
+    RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "cpu_mpi on ${NP} processes failed: ${rc}")
+endif()
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${WORKDIR}/${result_name} ${REFERENCE}
+    RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${WORKDIR}/${result_name} differs from ${REFERENCE}")
+endif()
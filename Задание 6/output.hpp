@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+#ifdef WITH_LZ4
+#include <lz4.h>
+#endif
+
+// Запись итоговой сетки. Форматы:
+//  - text:   как раньше (output_MxN.txt, числа как у ostream, 6 значащих
+//            цифр), но через std::to_chars в большой буфер - тот же файл
+//            байт в байт, только без ostream на каждый элемент;
+//  - binary: заголовок result_header и сырые double (output_MxN.bin);
+//  - zstd / lz4: то же, данные сжаты блоками по RESULT_BLOCK байт
+//            (output_MxN.bin.zst / .lz4), доступны при сборке с
+//            cmake -DWITH_ZSTD=ON / -DWITH_LZ4=ON (или -DWITH_ZSTD -lzstd /
+//            -DWITH_LZ4 -llz4 в Makefile).
+//
+// Запись идёт в фоновом потоке: submit() копирует сетку и сразу
+// возвращается, следующий расчёт начинается, пока пишется файл. Время
+// копирования и скорость записи собираются отдельно от времени счёта и
+// печатаются в finish(). Ошибки записи (не открылся файл, не хватило
+// места, сбой сжатия) фоновый поток не выбрасывает - иначе std::terminate
+// потерял бы весь прогон, - а запоминает по файлу; finish() их печатает
+// и возвращает false.
+
+enum class result_format { text, binary, zstd, lz4 };
+
+inline result_format parse_result_format(const std::string& name) {
+    if (name == "text") return result_format::text;
+    if (name == "binary") return result_format::binary;
+#ifdef WITH_ZSTD
+    if (name == "zstd") return result_format::zstd;
+#endif
+#ifdef WITH_LZ4
+    if (name == "lz4") return result_format::lz4;
+#endif
+    if (name == "zstd" || name == "lz4") {
+        throw std::invalid_argument("output '" + name + "' is not compiled in (build with cmake -DWITH_ZSTD=ON / -DWITH_LZ4=ON)");
+    }
+    throw std::invalid_argument("unknown output '" + name + "' (text|binary|zstd|lz4)");
+}
+
+// Заголовок двоичного файла (все поля little-endian, как на x86)
+struct result_header {
+    char magic[4] = { 'J', 'C', 'B', '1' };
+    uint32_t codec = 0;     // 0 - без сжатия, 1 - zstd, 2 - lz4
+    int32_t m = 0, n = 0;
+    uint32_t elem_size = sizeof(double);
+    uint32_t block = 0;     // размер несжатого блока (для сжатых форматов)
+    uint64_t payload = 0;   // байт данных после заголовка
+};
+
+const size_t RESULT_BLOCK = 1 << 24;  // 16 МБ несжатых данных на блок
+const size_t TEXT_BUFFER = 1 << 22;   // буфер текстового формата
+
+class result_writer {
+public:
+    result_writer() = default;
+    result_writer(const result_writer&) = delete;
+    result_writer& operator=(const result_writer&) = delete;
+
+    ~result_writer() {
+        finish(false);
+    }
+
+    void set_format(result_format f) {
+        format = f;
+    }
+
+    // копирует сетку m x n и ставит её в очередь на запись; если в
+    // очереди уже MAX_PENDING сеток, ждёт (чтобы не копить память)
+    void submit(const double *A, int m, int n) {
+        auto start = std::chrono::steady_clock::now();
+        job j{ m, n, std::vector<double>(A, A + (size_t)m * n) };
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!worker.joinable()) {
+                worker = std::thread(&result_writer::run, this);
+            }
+            done_cv.wait(lock, [&] { return queue.size() < MAX_PENDING; });
+            queue.push_back(std::move(j));
+        }
+        ready_cv.notify_one();
+        submit_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // дожидается записи всех файлов и печатает отчёт; false - какой-то
+    // файл не записан
+    bool finish(bool report = true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready_cv.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (!report) {
+            return true;
+        }
+        double total_mb = 0.0, total_ms = 0.0;
+        int failed = 0;
+        for (const record& r : records) {
+            if (!r.error.empty()) {
+                std::fprintf(stderr, "Write %s: FAILED (%s)\n", r.file.c_str(), r.error.c_str());
+                failed++;
+                continue;
+            }
+            std::printf("Write %s: %.1f MB (%.1f MB raw) in %.1f ms, %.1f MB/s\n", r.file.c_str(), r.bytes / 1e6,
+                        r.raw / 1e6, r.ms, r.raw / 1e3 / std::max(r.ms, 1e-3));
+            total_mb += r.raw / 1e6;
+            total_ms += r.ms;
+        }
+        std::printf("Write total: %.1f MB in %.1f ms in background (%.1f MB/s), %.1f ms blocking copy\n", total_mb,
+                    total_ms, total_mb * 1e3 / std::max(total_ms, 1e-3), submit_ms);
+        if (failed > 0) {
+            std::fprintf(stderr, "Write: %d of %zu files FAILED\n", failed, records.size());
+        }
+        records.clear();
+        return failed == 0;
+    }
+
+private:
+    struct job {
+        int m, n;
+        std::vector<double> grid;
+    };
+
+    struct record {
+        std::string file;
+        double bytes; // записано в файл
+        double raw;   // объём сетки (8 байт на элемент)
+        double ms;
+        std::string error; // пусто - записан
+    };
+
+    static const size_t MAX_PENDING = 2;
+
+    result_format format = result_format::text;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable ready_cv, done_cv;
+    std::deque<job> queue;
+    bool stopping = false;
+    std::vector<record> records; // пишет только фоновый поток, читает finish() после join
+    double submit_ms = 0.0;
+
+    void run() {
+        while (true) {
+            job j;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready_cv.wait(lock, [&] { return !queue.empty() || stopping; });
+                if (queue.empty()) {
+                    return;
+                }
+                j = std::move(queue.front());
+                queue.pop_front();
+            }
+            done_cv.notify_one();
+
+            auto start = std::chrono::steady_clock::now();
+            record r;
+            r.raw = (double)j.grid.size() * sizeof(double);
+            r.bytes = 0.0;
+            try {
+                r.bytes = (format == result_format::text) ? write_text(j, r.file) : write_binary(j, r.file);
+            }
+            catch (const std::exception& e) {
+                r.error = e.what();
+            }
+            r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            records.push_back(r);
+        }
+    }
+
+    static std::string file_name(const job& j, const char *ext) {
+        return "output_" + std::to_string(j.m) + "x" + std::to_string(j.n) + ext;
+    }
+
+    static FILE* open(const std::string& name) {
+        FILE *f = std::fopen(name.c_str(), "wb");
+        if (!f) {
+            throw std::runtime_error("cannot open " + name + ": " + std::strerror(errno));
+        }
+        return f;
+    }
+
+    // fclose с проверкой: записано меньше expected или ошибка потока - исключение
+    static void close(FILE *f, const std::string& name, double bytes, double expected) {
+        bool failed = std::ferror(f) != 0 || bytes != expected;
+        int saved = errno;
+        failed = (std::fclose(f) != 0) || failed;
+        if (failed) {
+            throw std::runtime_error("write error on " + name + ": " + std::strerror(saved ? saved : errno));
+        }
+    }
+
+    // строка i: "a b c ... \n", числа - как ostream << double (%g, 6 цифр)
+    static double write_text(const job& j, std::string& name) {
+        name = file_name(j, ".txt");
+        FILE *f = open(name);
+        std::vector<char> buf(TEXT_BUFFER);
+        const size_t reserve = 32; // с запасом на одно число и разделитель
+        size_t used = 0;
+        double bytes = 0.0, expected = 0.0;
+        for (int i = 0; i < j.m; i++) {
+            for (int k = 0; k < j.n; k++) {
+                if (used + reserve > buf.size()) {
+                    bytes += std::fwrite(buf.data(), 1, used, f);
+                    expected += used;
+                    used = 0;
+                }
+                char *end = std::to_chars(buf.data() + used, buf.data() + buf.size(), j.grid[(size_t)i*j.n + k],
+                                          std::chars_format::general, 6).ptr;
+                *end++ = ' ';
+                used = end - buf.data();
+            }
+            buf[used++] = '\n';
+        }
+        bytes += std::fwrite(buf.data(), 1, used, f);
+        expected += used;
+        close(f, name, bytes, expected);
+        return bytes;
+    }
+
+    double write_binary(const job& j, std::string& name) {
+        result_header h;
+        h.m = j.m;
+        h.n = j.n;
+        const char *data = (const char*)j.grid.data();
+        const size_t raw = j.grid.size() * sizeof(double);
+
+        std::vector<char> out; // сжатые блоки: [uint64 размер][данные]
+        if (format == result_format::binary) {
+            name = file_name(j, ".bin");
+            h.payload = raw;
+        }
+        else {
+            name = file_name(j, (format == result_format::zstd) ? ".bin.zst" : ".bin.lz4");
+            h.codec = (format == result_format::zstd) ? 1 : 2;
+            h.block = RESULT_BLOCK;
+            for (size_t off = 0; off < raw; off += RESULT_BLOCK) {
+                compress_block(data + off, std::min(RESULT_BLOCK, raw - off), out);
+            }
+            h.payload = out.size();
+        }
+
+        FILE *f = open(name);
+        double bytes = std::fwrite(&h, 1, sizeof(h), f);
+        bytes += (h.codec == 0) ? std::fwrite(data, 1, raw, f) : std::fwrite(out.data(), 1, out.size(), f);
+        close(f, name, bytes, (double)(sizeof(h) + h.payload));
+        return bytes;
+    }
+
+    void compress_block(const char *src, size_t size, std::vector<char>& out) {
+        size_t at = out.size();
+        uint64_t packed = 0;
+#ifdef WITH_ZSTD
+        if (format == result_format::zstd) {
+            size_t bound = ZSTD_compressBound(size);
+            out.resize(at + sizeof(packed) + bound);
+            packed = ZSTD_compress(out.data() + at + sizeof(packed), bound, src, size, 1);
+            if (ZSTD_isError(packed)) {
+                throw std::runtime_error(ZSTD_getErrorName(packed));
+            }
+        }
+#endif
+#ifdef WITH_LZ4
+        if (format == result_format::lz4) {
+            int bound = LZ4_compressBound((int)size);
+            out.resize(at + sizeof(packed) + bound);
+            packed = LZ4_compress_default(src, out.data() + at + sizeof(packed), (int)size, bound);
+            if (packed == 0) {
+                throw std::runtime_error("LZ4_compress_default failed");
+            }
+        }
+#endif
+        (void)src;
+        (void)size;
+        std::memcpy(out.data() + at, &packed, sizeof(packed));
+        out.resize(at + sizeof(packed) + packed);
+    }
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "jacobi.hpp"
+
+// Шаблон Якоби, специализированный на этапе компиляции по типу элемента
+// (float / double) и ширине вектора W.
+//
+// Сетка хранится с выровненными строками: начало - по 64 байта, длина
+// строки (ld) округлена вверх до строки кэша, так что A + i*ld выровнено
+// для любой i и векторные загрузки/записи центра, верхней и нижней строк
+// идут по выровненным адресам (соседи j-1, j+1 - невыровненные загрузки).
+//
+// W > 1 - явные векторы через расширение vector_size (GCC, Clang, nvc++);
+// W = 1 - скалярный вариант, он же - единственный для других компиляторов.
+// SIMD_BYTES - ширина регистра, под которую собрана программа.
+
+#if defined(__AVX512F__)
+const int SIMD_BYTES = 64;
+#elif defined(__AVX__)
+const int SIMD_BYTES = 32;
+#else
+const int SIMD_BYTES = 16;
+#endif
+
+const int LINE_BYTES = 64;
+
+template <class T>
+struct padded_grid {
+    int m, n;
+    size_t ld; // элементов в строке с выравниванием
+    T *data;
+
+    padded_grid(int m, int n) : m(m), n(n) {
+        const size_t per_line = LINE_BYTES / sizeof(T);
+        ld = (n + per_line - 1) / per_line * per_line;
+        data = (T*)std::aligned_alloc(LINE_BYTES, sizeof(T) * ld * m);
+        if (!data) {
+            throw std::bad_alloc();
+        }
+        #pragma omp parallel for schedule(static) // first-touch тем же разбиением, что и в проходах
+        for (int i = 0; i < m; i++) {
+            std::fill(row(i), row(i) + ld, T(0));
+        }
+    }
+
+    padded_grid(const padded_grid&) = delete;
+    padded_grid& operator=(const padded_grid&) = delete;
+
+    ~padded_grid() {
+        std::free(data);
+    }
+
+    T* row(int i) const {
+        return data + (size_t)i * ld;
+    }
+
+    void load(const double *A) {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                row(i)[j] = (T)A[(size_t)i*n + j];
+            }
+        }
+    }
+
+    void store(double *A) const {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                A[(size_t)i*n + j] = row(i)[j];
+            }
+        }
+    }
+};
+
+// скалярная строка для [lo, hi), возвращает max |out - mid|
+template <class T>
+inline T padded_row_scalar(T *out, const T *up, const T *mid, const T *down, int lo, int hi, T thau, T center) {
+    T eps = 0;
+    for (int j = lo; j < hi; j++) {
+        out[j] = thau * (center * mid[j] + mid[j-1] + mid[j+1] + up[j] + down[j]);
+        eps = std::max(eps, std::fabs(out[j] - mid[j]));
+    }
+    return eps;
+}
+
+// Векторная строка: вся строка идёт выровненными блоками по W, начиная
+// с j = 0. Первый блок задевает граничный столбец 0, последний - столбец
+// n - 1 и выравнивание; эти дорожки не входят в epsilon, а после прохода
+// в них возвращаются старые значения (граница и нули выравнивания). Чтения
+// mid[-1] и mid[ld] попадают в соседние строки - память своя.
+template <class T, int W>
+struct padded_row {
+    static T run(T *out, const T *up, const T *mid, const T *down, int n, T thau, T center) {
+#if defined(__GNUC__)
+        typedef T vec __attribute__((vector_size(W * sizeof(T))));
+        const vec vthau = vec{} + thau, vcenter = vec{} + center;
+        vec lane, veps = vec{};
+        for (int k = 0; k < W; k++) {
+            lane[k] = (T)k;
+        }
+
+        auto block = [&](int j) {
+            vec c = *(const vec*)(mid + j);
+            vec l, r;
+            std::memcpy(&l, mid + j - 1, sizeof(vec));
+            std::memcpy(&r, mid + j + 1, sizeof(vec));
+            vec v = vthau * (vcenter * c + l + r + *(const vec*)(up + j) + *(const vec*)(down + j));
+            *(vec*)(out + j) = v;
+            vec d = v - c;
+            return (d < 0) ? -d : d;
+        };
+        auto masked = [&](int j) {
+            vec col = lane + (T)j;
+            vec d = block(j);
+            veps = ((col >= (T)1) & (col <= (T)(n - 2)) & (veps < d)) ? d : veps;
+        };
+
+        masked(0);
+        int j = W;
+        for (; j + W <= n - 1; j += W) {
+            vec d = block(j);
+            veps = (veps > d) ? veps : d;
+        }
+        for (; j <= n - 1; j += W) {
+            masked(j);
+        }
+
+        out[0] = mid[0];
+        for (int k = n - 1; k < j; k++) {
+            out[k] = mid[k];
+        }
+        T eps = 0;
+        for (int k = 0; k < W; k++) {
+            eps = std::max(eps, veps[k]);
+        }
+        return eps;
+#else
+        return padded_row_scalar(out, up, mid, down, 1, n - 1, thau, center);
+#endif
+    }
+};
+
+template <class T>
+struct padded_row<T, 1> {
+    static T run(T *out, const T *up, const T *mid, const T *down, int n, T thau, T center) {
+        return padded_row_scalar(out, up, mid, down, 1, n - 1, thau, center);
+    }
+};
+
+// Итерации до epsilon < epsilonMin (как в iterate() cpu_multicore: число
+// проходов, после которых изменение стало меньше порога) или iterMax.
+// Результат (в double) - в out. Возвращает число проходов.
+template <class T, int W>
+int iterate_padded(const double *A0, double *out, const stencil_params& p, int iterMax, double epsilonMin,
+                   double& epsilon) {
+    padded_grid<T> a(p.m, p.n), b(p.m, p.n);
+    a.load(A0);
+    b.load(A0); // граница у обеих сеток одна и та же
+    padded_grid<T> *A = &a, *Anew = &b;
+    const T thau = (T)p.thau, center = (T)p.center;
+
+    int sweeps = 0;
+    epsilon = 1.0;
+    while (sweeps < iterMax && epsilon >= epsilonMin) {
+        T eps = 0;
+        #pragma omp parallel for schedule(static) reduction(max:eps)
+        for (int i = 1; i < p.m - 1; i++) {
+            eps = std::max(eps, padded_row<T, W>::run(Anew->row(i), A->row(i-1), A->row(i), A->row(i+1), p.n,
+                                                      thau, center));
+        }
+        std::swap(A, Anew);
+        epsilon = eps;
+        sweeps++;
+    }
+    A->store(out);
+    return sweeps;
+}
+
+template <class T>
+constexpr int simd_width() {
+    return SIMD_BYTES / sizeof(T);
+}
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Общий замер производительности для всех заданий (C и C++).
+//
+// Раньше каждое задание мерило ровно один прогон своим cpuSecond() и
+// перебирало зашитый массив threads[]. Здесь:
+//  - перебираемые числа потоков и размеры задаются из командной строки
+//    (--threads 1,2,4 --sizes 20000,40000), по умолчанию - прежние массивы;
+//  - каждый замер - warmup прогонов без учёта и reps прогонов с учётом
+//    (--warmup W --reps R), в отчёт идут медиана, p95, среднее, stddev;
+//  - все замеры собираются в bench_report_t, и в конце bench_finish()
+//    печатает по каждой серии (ядро + размер) ускорение, эффективность,
+//    метрику Карпа-Флатта и оценку доли последовательной части по Амдалу,
+//    а с --json FILE / --csv FILE пишет то же в файл.
+//
+//     bench_config_t bench;
+//     bench_config_init(&bench, threads, 8, sizes, 2);
+//     for (...) if (bench_parse_arg(&bench, argc, argv, &i)) continue; ...
+//     bench_stats_t st;
+//     BENCH_MEASURE(&bench, st, run_parallel(n, n, kernel)); // выражение возвращает мс
+//     bench_record(&report, "omp", "serial", n, threads, st);
+//     bench_finish(&bench, &report, "task2.1");
+
+#define BENCH_MAX_SWEEP 64
+#define BENCH_MAX_REPS 1000
+#define BENCH_MAX_RECORDS 1024
+#define BENCH_NAME 48
+
+typedef struct {
+    int warmup, reps;
+    int threads[BENCH_MAX_SWEEP];
+    int nthreads;
+    long sizes[BENCH_MAX_SWEEP];
+    int nsizes;
+    const char *json, *csv; // NULL - не писать
+} bench_config_t;
+
+typedef struct {
+    int n;
+    double median, p95, mean, stddev, min, max; // мс
+} bench_stats_t;
+
+typedef struct {
+    char kernel[BENCH_NAME];
+    char baseline[BENCH_NAME]; // с чем считать ускорение ("" - с этим же ядром на наименьшем числе потоков)
+    long size;
+    int threads;
+    bench_stats_t stats;
+} bench_record_t;
+
+typedef struct {
+    bench_record_t records[BENCH_MAX_RECORDS];
+    int count;
+} bench_report_t;
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1.e-9;
+}
+
+static inline void bench_config_init(bench_config_t *cfg, const int *threads, int nthreads, const long *sizes,
+                                     int nsizes) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->warmup = 0;
+    cfg->reps = 1;
+    for (int i = 0; i < nthreads && i < BENCH_MAX_SWEEP; i++) {
+        cfg->threads[cfg->nthreads++] = threads[i];
+    }
+    for (int i = 0; i < nsizes && i < BENCH_MAX_SWEEP; i++) {
+        cfg->sizes[cfg->nsizes++] = sizes[i];
+    }
+}
+
+// "1,2,4" -> out, возвращает число элементов
+static inline int bench_parse_list(const char *s, long *out, int max) {
+    int n = 0;
+    while (*s && n < max) {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (end == s) {
+            break;
+        }
+        out[n++] = v;
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return n;
+}
+
+// Разбирает argv[*i], если это опция замера (тогда сдвигает *i за её
+// значение и возвращает 1); иначе возвращает 0 - опцию разбирает main.
+static inline int bench_parse_arg(bench_config_t *cfg, int argc, char *argv[], int *i) {
+    const char *opt = argv[*i];
+    if (*i + 1 >= argc) {
+        return 0;
+    }
+    const char *val = argv[*i + 1];
+    if (strcmp(opt, "--threads") == 0) {
+        long tmp[BENCH_MAX_SWEEP];
+        int n = bench_parse_list(val, tmp, BENCH_MAX_SWEEP);
+        for (int k = 0; k < n; k++) {
+            cfg->threads[k] = (int)tmp[k];
+        }
+        cfg->nthreads = n;
+    }
+    else if (strcmp(opt, "--sizes") == 0) {
+        cfg->nsizes = bench_parse_list(val, cfg->sizes, BENCH_MAX_SWEEP);
+    }
+    else if (strcmp(opt, "--warmup") == 0) {
+        cfg->warmup = atoi(val);
+    }
+    else if (strcmp(opt, "--reps") == 0) {
+        int reps = atoi(val);
+        cfg->reps = (reps < 1) ? 1 : (reps > BENCH_MAX_REPS ? BENCH_MAX_REPS : reps);
+    }
+    else if (strcmp(opt, "--json") == 0) {
+        cfg->json = val;
+    }
+    else if (strcmp(opt, "--csv") == 0) {
+        cfg->csv = val;
+    }
+    else {
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+static inline int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// samples сортируются на месте
+static inline bench_stats_t bench_stats(double *samples, int n) {
+    bench_stats_t st;
+    memset(&st, 0, sizeof(st));
+    if (n <= 0) {
+        return st;
+    }
+    qsort(samples, n, sizeof(double), bench_compare_double);
+    st.n = n;
+    st.min = samples[0];
+    st.max = samples[n - 1];
+    st.median = (n & 1) ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    int k = (int)ceil(0.95 * n) - 1; // ближайший ранг
+    st.p95 = samples[k < 0 ? 0 : k];
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    st.mean = sum / n;
+    double var = 0.0;
+    for (int i = 0; i < n; i++) {
+        var += (samples[i] - st.mean) * (samples[i] - st.mean);
+    }
+    st.stddev = (n > 1) ? sqrt(var / (n - 1)) : 0.0;
+    return st;
+}
+
+// expr - выражение, возвращающее время одного прогона в мс (как run_*
+// в заданиях: подготовка данных в замер не входит)
+#define BENCH_MEASURE(cfg, stats, expr)                               \
+    do {                                                              \
+        double bench_samples_[BENCH_MAX_REPS];                        \
+        for (int bench_w_ = 0; bench_w_ < (cfg)->warmup; bench_w_++) { \
+            (void)(expr);                                             \
+        }                                                             \
+        for (int bench_r_ = 0; bench_r_ < (cfg)->reps; bench_r_++) {  \
+            bench_samples_[bench_r_] = (expr);                        \
+        }                                                             \
+        (stats) = bench_stats(bench_samples_, (cfg)->reps);           \
+    } while (0)
+
+static inline void bench_record(bench_report_t *report, const char *kernel, const char *baseline, long size,
+                                int threads, bench_stats_t stats) {
+    if (report->count >= BENCH_MAX_RECORDS) {
+        return;
+    }
+    bench_record_t *r = &report->records[report->count++];
+    snprintf(r->kernel, BENCH_NAME, "%s", kernel);
+    snprintf(r->baseline, BENCH_NAME, "%s", baseline ? baseline : "");
+    r->size = size;
+    r->threads = threads;
+    r->stats = stats;
+}
+
+// Запись того же размера с ядром name на наименьшем числе потоков (NULL,
+// если такой нет).
+static inline const bench_record_t *bench_find_base(const bench_report_t *report, const char *name, long size) {
+    const bench_record_t *best = NULL;
+    for (int k = 0; k < report->count; k++) {
+        const bench_record_t *c = &report->records[k];
+        if (c->size == size && strcmp(c->kernel, name) == 0 && (!best || c->threads < best->threads)) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+typedef struct {
+    double speedup;    // относительно baseline-ядра (или себя на наименьшем числе потоков)
+    double scaling;    // относительно себя же на наименьшем числе потоков
+    double efficiency; // scaling / (во сколько раз больше потоков)
+    double karp_flatt; // экспериментальная последовательная доля, NAN без роста числа потоков
+    double rel;        // во сколько раз больше потоков, чем в базе scaling
+} bench_derived_t;
+
+// Эффективность, Карп-Флатт и Амдал считаются по масштабированию ядра
+// самого с собой: у baseline другой алгоритм (например, blocked против
+// serial), и его ускорение на 1 потоке к параллельности не относится.
+static inline bench_derived_t bench_derive(const bench_report_t *report, const bench_record_t *r) {
+    bench_derived_t d;
+    const bench_record_t *self = bench_find_base(report, r->kernel, r->size);
+    const bench_record_t *base = r->baseline[0] ? bench_find_base(report, r->baseline, r->size) : self;
+    if (!base) {
+        base = self;
+    }
+    int p = (r->threads > 0) ? r->threads : 1;
+    int p0 = (self->threads > 0) ? self->threads : 1;
+    d.rel = (double)p / p0;
+    d.speedup = (r->stats.median > 0.0) ? base->stats.median / r->stats.median : 0.0;
+    d.scaling = (r->stats.median > 0.0) ? self->stats.median / r->stats.median : 0.0;
+    d.efficiency = d.scaling / d.rel;
+    d.karp_flatt = (d.rel > 1.0 && d.scaling > 0.0) ? (1.0 / d.scaling - 1.0 / d.rel) / (1.0 - 1.0 / d.rel) : NAN;
+    return d;
+}
+
+// Закон Амдала S(p) = 1 / (f + (1 - f) / p): 1/S - 1/p = f * (1 - 1/p),
+// f - наименьшие квадраты по всем точкам серии (ядро + размер).
+static inline double bench_amdahl_fraction(const bench_report_t *report, const bench_record_t *first) {
+    double sxy = 0.0, sxx = 0.0;
+    for (int k = 0; k < report->count; k++) {
+        const bench_record_t *r = &report->records[k];
+        if (r->size != first->size || strcmp(r->kernel, first->kernel) != 0) {
+            continue;
+        }
+        bench_derived_t d = bench_derive(report, r);
+        if (d.rel <= 1.0 || d.scaling <= 0.0) {
+            continue;
+        }
+        double x = 1.0 - 1.0 / d.rel, y = 1.0 / d.scaling - 1.0 / d.rel;
+        sxy += x * y;
+        sxx += x * x;
+    }
+    if (sxx == 0.0) {
+        return NAN;
+    }
+    double f = sxy / sxx;
+    return (f < 0.0) ? 0.0 : (f > 1.0 ? 1.0 : f);
+}
+
+static inline int bench_first_of_series(const bench_report_t *report, int k) {
+    for (int j = 0; j < k; j++) {
+        if (report->records[j].size == report->records[k].size &&
+            strcmp(report->records[j].kernel, report->records[k].kernel) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static inline void bench_csv_number(FILE *f, double x) {
+    if (isfinite(x)) {
+        fprintf(f, ",%.6f", x);
+    }
+    else {
+        fprintf(f, ",");
+    }
+}
+
+static inline void bench_write_csv(const bench_report_t *report, const char *task, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return;
+    }
+    fprintf(f, "task,kernel,baseline,size,threads,reps,median_ms,p95_ms,mean_ms,stddev_ms,min_ms,max_ms,"
+               "speedup,scaling,efficiency,karp_flatt,amdahl_serial_fraction\n");
+    for (int k = 0; k < report->count; k++) {
+        const bench_record_t *r = &report->records[k];
+        bench_derived_t d = bench_derive(report, r);
+        fprintf(f, "%s,%s,%s,%ld,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f", task, r->kernel, r->baseline, r->size,
+                r->threads, r->stats.n, r->stats.median, r->stats.p95, r->stats.mean, r->stats.stddev, r->stats.min,
+                r->stats.max);
+        bench_csv_number(f, d.speedup);
+        bench_csv_number(f, d.scaling);
+        bench_csv_number(f, d.efficiency);
+        bench_csv_number(f, d.karp_flatt); // пустое поле вместо nan при p = 1, как null в JSON
+        bench_csv_number(f, bench_amdahl_fraction(report, r));
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+static inline void bench_json_number(FILE *f, double x) {
+    if (isfinite(x)) {
+        fprintf(f, "%.6f", x);
+    }
+    else {
+        fprintf(f, "null");
+    }
+}
+
+static inline void bench_write_json(const bench_config_t *cfg, const bench_report_t *report, const char *task,
+                                    const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return;
+    }
+    fprintf(f, "{\n  \"task\": \"%s\",\n  \"warmup\": %d,\n  \"reps\": %d,\n  \"records\": [\n", task, cfg->warmup,
+            cfg->reps);
+    for (int k = 0; k < report->count; k++) {
+        const bench_record_t *r = &report->records[k];
+        bench_derived_t d = bench_derive(report, r);
+        fprintf(f, "    {\"kernel\": \"%s\", \"baseline\": \"%s\", \"size\": %ld, \"threads\": %d, \"reps\": %d, ",
+                r->kernel, r->baseline, r->size, r->threads, r->stats.n);
+        fprintf(f, "\"median_ms\": %.6f, \"p95_ms\": %.6f, \"mean_ms\": %.6f, \"stddev_ms\": %.6f, ",
+                r->stats.median, r->stats.p95, r->stats.mean, r->stats.stddev);
+        fprintf(f, "\"min_ms\": %.6f, \"max_ms\": %.6f, \"speedup\": ", r->stats.min, r->stats.max);
+        bench_json_number(f, d.speedup);
+        fprintf(f, ", \"scaling\": ");
+        bench_json_number(f, d.scaling);
+        fprintf(f, ", \"efficiency\": ");
+        bench_json_number(f, d.efficiency);
+        fprintf(f, ", \"karp_flatt\": ");
+        bench_json_number(f, d.karp_flatt);
+        fprintf(f, "}%s\n", (k + 1 < report->count) ? "," : "");
+    }
+    fprintf(f, "  ],\n  \"amdahl\": [\n");
+    int first = 1;
+    for (int k = 0; k < report->count; k++) {
+        if (!bench_first_of_series(report, k)) {
+            continue;
+        }
+        const bench_record_t *r = &report->records[k];
+        double frac = bench_amdahl_fraction(report, r);
+        fprintf(f, "%s    {\"kernel\": \"%s\", \"size\": %ld, \"serial_fraction\": ", first ? "" : ",\n", r->kernel,
+                r->size);
+        bench_json_number(f, frac);
+        fprintf(f, ", \"max_speedup\": ");
+        bench_json_number(f, (frac > 0.0) ? 1.0 / frac : NAN);
+        fprintf(f, "}");
+        first = 0;
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+// сводка в stdout и файлы --json / --csv
+static inline void bench_finish(const bench_config_t *cfg, const bench_report_t *report, const char *task) {
+    printf("\n=== BENCHMARK SUMMARY (%s, warmup %d, reps %d) ===\n", task, cfg->warmup, cfg->reps);
+    printf("%-24s %10s %7s %12s %12s %10s %8s %8s %6s %8s\n", "kernel", "size", "threads", "median ms", "p95 ms",
+           "stddev", "speedup", "scaling", "eff", "K-F");
+    for (int k = 0; k < report->count; k++) {
+        const bench_record_t *r = &report->records[k];
+        bench_derived_t d = bench_derive(report, r);
+        printf("%-24s %10ld %7d %12.3f %12.3f %10.3f %8.3f %8.3f %6.3f %8.4f\n", r->kernel, r->size, r->threads,
+               r->stats.median, r->stats.p95, r->stats.stddev, d.speedup, d.scaling, d.efficiency, d.karp_flatt);
+    }
+    for (int k = 0; k < report->count; k++) {
+        if (!bench_first_of_series(report, k)) {
+            continue;
+        }
+        double frac = bench_amdahl_fraction(report, &report->records[k]);
+        if (isfinite(frac)) {
+            printf("Amdahl fit %s %ld: serial fraction %.4f, max speedup %.1f\n", report->records[k].kernel,
+                   report->records[k].size, frac, (frac > 0.0) ? 1.0 / frac : INFINITY);
+        }
+    }
+    if (cfg->json) {
+        bench_write_json(cfg, report, task, cfg->json);
+        printf("Benchmark JSON: %s\n", cfg->json);
+    }
+    if (cfg->csv) {
+        bench_write_csv(report, task, cfg->csv);
+        printf("Benchmark CSV: %s\n", cfg->csv);
+    }
+}
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__) && !defined(NO_PERF_COUNTERS)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_HAVE_EVENTS 1
+#endif
+
+// Аппаратные счётчики (perf_event_open) для именованных участков ядер
+// (C и C++).
+//
+// Участок отмечается в каждом потоке, который его выполняет:
+//
+//     int region = PERF_REGION("omp");     // вне параллельной области
+//     #pragma omp parallel
+//     {
+//         PERF_BEGIN(region);
+//         ... своя часть работы ...
+//         PERF_END(region);
+//     }
+//     perf_print_region(region, flops, bytes, ms); // рядом с печатью времени
+//
+// Каждый поток при первом PERF_BEGIN получает номер и открывает свою
+// группу счётчиков (циклы, инструкции, промахи LLC), дальше только читает
+// её одним read(). При завершении потока группа закрывается, а номер
+// достаётся следующему новому потоку - пулы, которые создаются заново на
+// каждый прогон, не копят дескрипторы и не упираются в PERF_MAX_THREADS.
+// По номеру копятся время, счётчики и число входов; промахи LLC
+// * 64 байта / время - пропускная способность памяти потока.
+// perf_print_region() печатает итог по участку и roofline: по модели
+// работы одного прогона ядра (flops, bytes) и его времени из замера -
+// достигнутые GFLOP/s против потолка AI * пропускная способность STREAM
+// (триада меряется один раз при первой печати, если задание не передало
+// калибровку stream.h через perf_set_stream_bandwidth()).
+//
+// Пока счётчики не включены (perf_enable(1), в заданиях - --perf), каждый
+// макрос - одна проверка флага; с -DNO_PERF_COUNTERS макросы пустые.
+// Если PMU недоступен (виртуальная машина, perf_event_paranoid), время и
+// roofline по модели работы всё равно печатаются.
+
+#define PERF_MAX_REGIONS 32
+#define PERF_MAX_THREADS 256
+#define PERF_NAME 48
+#define PERF_LINE_BYTES 64.0
+#define PERF_STREAM_N (1 << 23) // элементов в массиве триады, 3 x 64 МБ
+
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_NCOUNTERS };
+
+typedef struct {
+    uint64_t counts[PERF_NCOUNTERS];
+    uint64_t start[PERF_NCOUNTERS];
+    double seconds, t0;
+    long calls;
+    int used;
+} perf_slot_t;
+
+typedef struct {
+    char name[PERF_NAME];
+    perf_slot_t threads[PERF_MAX_THREADS];
+} perf_region_t;
+
+typedef struct {
+    int enabled;
+    int counters;   // число счётчиков в группе у всех потоков (0 - PMU недоступен)
+    int opened;     // группу уже открывал хотя бы один поток (иначе counters не задан)
+    int warned;
+    int nregions;
+    int nthreads;   // выдано номеров потоков, все perf_tid < nthreads
+    int nfree;      // номера завершившихся потоков, выдаются снова
+    int free_tids[PERF_MAX_THREADS];
+    int fds[PERF_MAX_THREADS][PERF_NCOUNTERS]; // счётчики потока с этим номером, -1 - нет
+    double stream_gbs; // 0 - ещё не мерили
+    perf_region_t regions[PERF_MAX_REGIONS];
+} perf_state_t;
+
+static perf_state_t perf_state; // нули: counters задаёт первый открывший группу поток
+static pthread_mutex_t perf_lock = PTHREAD_MUTEX_INITIALIZER; // номера и дескрипторы потоков
+static pthread_key_t perf_key;  // деструктор закрывает группу завершившегося потока
+static pthread_once_t perf_key_once = PTHREAD_ONCE_INIT;
+
+static __thread int perf_tid = -1;     // -2 - свободных номеров нет, поток не считается
+static __thread int perf_fd = -1;      // лидер группы, -2 - открыть не удалось
+static __thread int perf_nopen = 0;    // сколько счётчиков в группе этого потока
+
+static inline double perf_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1.e-9;
+}
+
+static inline void perf_enable(int on) {
+    perf_state.enabled = on;
+}
+
+// номер участка по имени (регистрирует новый); вызывать вне параллельных областей
+static inline int perf_region(const char *name) {
+    for (int k = 0; k < perf_state.nregions; k++) {
+        if (strcmp(perf_state.regions[k].name, name) == 0) {
+            return k;
+        }
+    }
+    if (perf_state.nregions >= PERF_MAX_REGIONS) {
+        return -1;
+    }
+    perf_region_t *r = &perf_state.regions[perf_state.nregions];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, PERF_NAME, "%s", name);
+    return perf_state.nregions++;
+}
+
+#ifdef PERF_HAVE_EVENTS
+static inline int perf_open_event(uint32_t type, uint64_t config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0); // этот поток, любой CPU
+}
+
+// группа счётчиков этого потока; fds - открытые дескрипторы (остальные -1)
+static inline void perf_thread_open(int *fds) {
+    const uint64_t configs[PERF_NCOUNTERS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_MISSES };
+    perf_fd = perf_open_event(PERF_TYPE_HARDWARE, configs[0], -1);
+    if (perf_fd < 0) {
+        perf_fd = -2;
+        perf_nopen = 0;
+    }
+    else {
+        fds[0] = perf_fd;
+        perf_nopen = 1;
+        // счётчики после первого неоткрывшегося в группу не добавляются,
+        // чтобы порядок значений в read() совпадал с PERF_CYCLES...
+        while (perf_nopen < PERF_NCOUNTERS &&
+               (fds[perf_nopen] = perf_open_event(PERF_TYPE_HARDWARE, configs[perf_nopen], perf_fd)) >= 0) {
+            perf_nopen++;
+        }
+        ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static inline void perf_thread_close(const int *fds) {
+    for (int k = 0; k < PERF_NCOUNTERS; k++) {
+        if (fds[k] >= 0) {
+            close(fds[k]);
+        }
+    }
+}
+
+static inline void perf_read(uint64_t *out) {
+    uint64_t buf[1 + PERF_NCOUNTERS] = { 0 };
+    if (perf_fd >= 0 && read(perf_fd, buf, sizeof(buf)) > 0) {
+        for (int k = 0; k < PERF_NCOUNTERS; k++) {
+            out[k] = (k < perf_nopen) ? buf[1 + k] : 0;
+        }
+    }
+    else {
+        memset(out, 0, sizeof(uint64_t) * PERF_NCOUNTERS);
+    }
+}
+#else
+static inline void perf_thread_open(int *fds) {
+    (void)fds;
+    perf_fd = -2;
+    perf_nopen = 0;
+}
+
+static inline void perf_thread_close(const int *fds) {
+    (void)fds;
+}
+
+static inline void perf_read(uint64_t *out) {
+    memset(out, 0, sizeof(uint64_t) * PERF_NCOUNTERS);
+}
+#endif
+
+// деструктор perf_key: поток завершается - закрыть его группу, вернуть номер
+static inline void perf_thread_exit(void *value) {
+    int tid = (int)(intptr_t)value - 1;
+    pthread_mutex_lock(&perf_lock);
+    perf_thread_close(perf_state.fds[tid]);
+    perf_state.free_tids[perf_state.nfree++] = tid;
+    pthread_mutex_unlock(&perf_lock);
+}
+
+static inline void perf_key_create(void) {
+    pthread_key_create(&perf_key, perf_thread_exit);
+}
+
+// первый вход потока в участок: номер (освободившийся или новый) и группа счётчиков
+static inline void perf_thread_attach(void) {
+    pthread_once(&perf_key_once, perf_key_create);
+    pthread_mutex_lock(&perf_lock);
+    if (perf_state.nfree > 0) {
+        perf_tid = perf_state.free_tids[--perf_state.nfree];
+    }
+    else if (perf_state.nthreads < PERF_MAX_THREADS) {
+        perf_tid = perf_state.nthreads++;
+    }
+    else {
+        perf_tid = -2;
+    }
+    if (perf_tid >= 0) {
+        int *fds = perf_state.fds[perf_tid];
+        for (int k = 0; k < PERF_NCOUNTERS; k++) {
+            fds[k] = -1;
+        }
+        perf_thread_open(fds);
+        if (!perf_state.opened || perf_nopen < perf_state.counters) {
+            perf_state.counters = perf_nopen; // общее для всех - меньшее
+        }
+        perf_state.opened = 1;
+    }
+    pthread_mutex_unlock(&perf_lock);
+    if (perf_tid >= 0) {
+        pthread_setspecific(perf_key, (void*)(intptr_t)(perf_tid + 1)); // не NULL, иначе деструктора не будет
+    }
+}
+
+static inline perf_slot_t *perf_slot(int region) {
+    if (region < 0) {
+        return NULL;
+    }
+    if (perf_tid == -1) {
+        perf_thread_attach();
+    }
+    if (perf_tid < 0) {
+        return NULL;
+    }
+    return &perf_state.regions[region].threads[perf_tid];
+}
+
+static inline void perf_begin(int region) {
+    perf_slot_t *s = perf_slot(region);
+    if (s) {
+        s->t0 = perf_now();
+        perf_read(s->start);
+    }
+}
+
+static inline void perf_end(int region) {
+    perf_slot_t *s = perf_slot(region);
+    if (s) {
+        uint64_t now[PERF_NCOUNTERS];
+        perf_read(now);
+        s->seconds += perf_now() - s->t0;
+        for (int k = 0; k < PERF_NCOUNTERS; k++) {
+            s->counts[k] += now[k] - s->start[k];
+        }
+        s->calls++;
+        s->used = 1;
+    }
+}
+
+#ifdef NO_PERF_COUNTERS
+#define PERF_REGION(name) (-1)
+#define PERF_BEGIN(region) ((void)0)
+#define PERF_END(region) ((void)0)
+#else
+#define PERF_REGION(name) (perf_state.enabled ? perf_region(name) : -1)
+#define PERF_BEGIN(region)                 \
+    do {                                   \
+        if (perf_state.enabled) {          \
+            perf_begin(region);            \
+        }                                  \
+    } while (0)
+#define PERF_END(region)                   \
+    do {                                   \
+        if (perf_state.enabled) {          \
+            perf_end(region);              \
+        }                                  \
+    } while (0)
+#endif
+
+// потолок памяти для roofline из калибровки (stream.h) вместо своей триады
+static inline void perf_set_stream_bandwidth(double gbs) {
+    perf_state.stream_gbs = gbs;
+}
+
+// пропускная способность памяти на триаде a = b + s * c (ГБ/с, лучший из 5 прогонов)
+static inline double perf_stream_bandwidth(void) {
+    if (perf_state.stream_gbs > 0.0) {
+        return perf_state.stream_gbs;
+    }
+    const long n = PERF_STREAM_N;
+    double *a = (double*)malloc(sizeof(double) * n);
+    double *b = (double*)malloc(sizeof(double) * n);
+    double *c = (double*)malloc(sizeof(double) * n);
+    if (!a || !b || !c) {
+        free(a);
+        free(b);
+        free(c);
+        return 0.0;
+    }
+    #pragma omp parallel for schedule(static) // first-touch тем же разбиением
+    for (long i = 0; i < n; i++) {
+        a[i] = 0.0;
+        b[i] = 1.0;
+        c[i] = 2.0;
+    }
+    double best = 1.e30;
+    for (int rep = 0; rep < 5; rep++) {
+        double t = perf_now();
+        #pragma omp parallel for schedule(static)
+        for (long i = 0; i < n; i++) {
+            a[i] = b[i] + 3.0 * c[i];
+        }
+        t = perf_now() - t;
+        best = (t < best) ? t : best;
+    }
+    free(a);
+    free(b);
+    free(c);
+    perf_state.stream_gbs = 3.0 * sizeof(double) * n / best * 1.e-9;
+    return perf_state.stream_gbs;
+}
+
+// Итог по участку после замера (все входы с прошлой печати); потом
+// участок обнуляется. flops и bytes - модель одного прогона ядра (bytes -
+// минимальный обмен с памятью: каждый массив читается/пишется один раз),
+// ms - время прогона из замера; flops = 0 - без roofline.
+static inline void perf_print_region(int region, double flops, double bytes, double ms) {
+    if (!perf_state.enabled || region < 0) {
+        return;
+    }
+    perf_region_t *r = &perf_state.regions[region];
+    const int nc = perf_state.counters;
+    uint64_t total[PERF_NCOUNTERS] = { 0 };
+    double busy = 0.0; // наибольшее время потока
+    int threads = 0;
+    for (int t = 0; t < PERF_MAX_THREADS && t < perf_state.nthreads; t++) {
+        perf_slot_t *s = &r->threads[t];
+        if (!s->used) {
+            continue;
+        }
+        threads++;
+        busy = (s->seconds > busy) ? s->seconds : busy;
+        for (int k = 0; k < PERF_NCOUNTERS; k++) {
+            total[k] += s->counts[k];
+        }
+    }
+    if (threads == 0) {
+        return;
+    }
+
+    printf("  [perf %s] %d threads, %.3f ms busy", r->name, threads, busy * 1000);
+    if (nc > PERF_INSTRUCTIONS) {
+        printf(", %.3e cycles, %.3e instructions (IPC %.2f)", (double)total[PERF_CYCLES],
+               (double)total[PERF_INSTRUCTIONS],
+               total[PERF_CYCLES] ? (double)total[PERF_INSTRUCTIONS] / total[PERF_CYCLES] : 0.0);
+    }
+    if (nc > PERF_LLC_MISSES) {
+        printf(", %.3e LLC misses (%.3f GB/s)", (double)total[PERF_LLC_MISSES],
+               total[PERF_LLC_MISSES] * PERF_LINE_BYTES / busy * 1.e-9);
+    }
+    if (nc == 0 && !perf_state.warned) {
+        printf(" (hardware counters unavailable)");
+        perf_state.warned = 1;
+    }
+    printf("\n");
+    if (threads > 1) {
+        for (int t = 0; t < PERF_MAX_THREADS && t < perf_state.nthreads; t++) {
+            perf_slot_t *s = &r->threads[t];
+            if (!s->used) {
+                continue;
+            }
+            printf("    thread %d: %.3f ms, %ld calls", t, s->seconds * 1000, s->calls);
+            if (nc > PERF_INSTRUCTIONS) {
+                printf(", IPC %.2f", s->counts[PERF_CYCLES] ?
+                       (double)s->counts[PERF_INSTRUCTIONS] / s->counts[PERF_CYCLES] : 0.0);
+            }
+            if (nc > PERF_LLC_MISSES) {
+                printf(", %.3f GB/s from LLC misses", s->counts[PERF_LLC_MISSES] * PERF_LINE_BYTES / s->seconds * 1.e-9);
+            }
+            printf("\n");
+        }
+    }
+
+    if (flops > 0.0 && bytes > 0.0 && ms > 0.0) {
+        double bw = perf_stream_bandwidth();
+        double ai = flops / bytes;
+        double gflops = flops / (ms * 1.e6);
+        double roof = ai * bw;
+        // доля потолка памяти: близко к 1 - упёрлись в пропускную способность,
+        // заметно выше 1 - данные живут в кэше; далеко от 1 при высоком IPC -
+        // в вычисления, при низком - в задержки
+        double ipc = (nc > PERF_INSTRUCTIONS && total[PERF_CYCLES]) ?
+                     (double)total[PERF_INSTRUCTIONS] / total[PERF_CYCLES] : NAN;
+        const char *bound = (gflops > 1.2 * roof) ? "cache-resident" :
+                            (gflops >= 0.6 * roof) ? "bandwidth-bound" :
+                            isnan(ipc) ? "below memory roof" : (ipc >= 1.5 ? "compute-bound" : "latency-bound");
+        printf("  [roofline %s] %.3f GFLOP/s at %.3f FLOP/byte, %.3f GB/s; memory roof %.3f GFLOP/s "
+               "(STREAM %.3f GB/s): %.1f%% of roof, %s\n", r->name, gflops, ai, bytes / (ms * 1.e6),
+               roof, bw, 100.0 * gflops / roof, bound);
+    }
+
+    char name[PERF_NAME];
+    memcpy(name, r->name, PERF_NAME);
+    memset(r, 0, sizeof(*r));
+    memcpy(r->name, name, PERF_NAME);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <math.h>
+
+// Воспроизводимое параллельное суммирование (C и C++).
+//
+// Обычная сумма double зависит от порядка сложения, а значит и от числа
+// потоков. Здесь диапазон режется на блоки фиксированного размера, не
+// зависящего от числа потоков; каждый блок суммируется по Ноймайеру
+// (Kahan с поправкой на случай |x| > |sum|), а суммы блоков сводятся
+// попарным деревом в одном и том же порядке. Поток может обработать
+// любой набор блоков - результат побитово одинаков при 1 и при 80 потоках.
+//
+//     int nblocks = reduce_blocks(n, REDUCE_BLOCK);
+//     #pragma omp parallel for schedule(static)
+//     for (int k = 0; k < nblocks; k++) {
+//         neumaier_t acc = NEUMAIER_ZERO;
+//         for (int i = k * REDUCE_BLOCK; i < n && i < (k + 1) * REDUCE_BLOCK; i++)
+//             neumaier_add(&acc, x[i]);
+//         blocks[k] = acc;
+//     }
+//     double sum = neumaier_result(reduce_pairwise(blocks, 0, nblocks));
+
+#define REDUCE_BLOCK 65536
+
+typedef struct {
+    double sum;
+    double c; // накопленная поправка (потерянные младшие разряды)
+} neumaier_t;
+
+#ifdef __cplusplus
+#define NEUMAIER_ZERO (neumaier_t{ 0.0, 0.0 })
+#else
+#define NEUMAIER_ZERO ((neumaier_t){ 0.0, 0.0 })
+#endif
+
+static inline void neumaier_add(neumaier_t *acc, double x) {
+    double t = acc->sum + x;
+    if (fabs(acc->sum) >= fabs(x)) {
+        acc->c += (acc->sum - t) + x;
+    }
+    else {
+        acc->c += (x - t) + acc->sum;
+    }
+    acc->sum = t;
+}
+
+static inline void neumaier_merge(neumaier_t *acc, const neumaier_t *other) {
+    neumaier_add(acc, other->sum);
+    acc->c += other->c;
+}
+
+static inline double neumaier_result(neumaier_t acc) {
+    return acc.sum + acc.c;
+}
+
+static inline int reduce_blocks(long long n, int block) {
+    return (int)((n + block - 1) / block);
+}
+
+// попарное дерево над blocks[lo, hi): форма дерева зависит только от
+// числа блоков, массив не меняется, так что его могут сводить
+// одновременно все потоки и получить одно и то же значение
+static inline neumaier_t reduce_pairwise(const neumaier_t *blocks, int lo, int hi) {
+    if (hi <= lo) {
+        return NEUMAIER_ZERO;
+    }
+    if (hi - lo == 1) {
+        return blocks[lo];
+    }
+    int mid = lo + (hi - lo) / 2;
+    neumaier_t left = reduce_pairwise(blocks, lo, mid);
+    neumaier_t right = reduce_pairwise(blocks, mid, hi);
+    neumaier_merge(&left, &right);
+    return left;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Калибровка памяти (C и C++): ядра STREAM (copy, scale, add, triad) и
+// тест задержки "погоня за указателем" на тех же потоках и с той же
+// привязкой, что и основной замер - запускает их само задание своим
+// способом (omp в 2.1, пул в 3.1) по диапазонам stream_range().
+//
+// Результаты по числу потоков хранятся в CSV (stream_table_save/load):
+// --calibrate пишет файл, обычный запуск его читает и рядом с GB/s ядра
+// печатает долю достижимой пропускной способности - лучшего из четырёх
+// ядер STREAM на том же числе потоков (stream_print_fraction).
+//
+// Соглашения STREAM: байты на элемент - 16 у copy/scale, 24 у add/triad;
+// время - лучший из STREAM_REPS прогонов (первый не считается).
+
+#define STREAM_REPS 10
+#define STREAM_MAX_ROWS 64
+#define STREAM_SCALAR 3.0
+#define STREAM_CHASE_STEPS (1L << 21) // переходов на поток
+#define STREAM_LINE_WORDS 8           // size_t в строке кэша: цепочка идёт по строкам
+
+enum { STREAM_COPY, STREAM_SCALE, STREAM_ADD, STREAM_TRIAD, STREAM_KERNELS };
+
+static const char *stream_names[STREAM_KERNELS] = { "copy", "scale", "add", "triad" };
+static const double stream_bytes[STREAM_KERNELS] = { 16.0, 16.0, 24.0, 24.0 };
+
+typedef struct {
+    int threads;
+    double gbs[STREAM_KERNELS];
+    double latency_ns; // средняя задержка загрузки при одновременной погоне во всех потоках
+} stream_result_t;
+
+typedef struct {
+    stream_result_t rows[STREAM_MAX_ROWS];
+    int count;
+} stream_table_t;
+
+static inline double stream_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1.e-9;
+}
+
+// статическое разбиение [0, n) на nthreads непрерывных кусков
+static inline void stream_range(long n, int tid, int nthreads, long *lb, long *ub) {
+    *lb = (long)((long long)n * tid / nthreads);
+    *ub = (long)((long long)n * (tid + 1) / nthreads);
+}
+
+static inline void stream_init(double *a, double *b, double *c, long lb, long ub) {
+    for (long i = lb; i < ub; i++) {
+        a[i] = 1.0;
+        b[i] = 2.0;
+        c[i] = 0.0;
+    }
+}
+
+static inline void stream_kernel(int kernel, double *a, double *b, double *c, long lb, long ub) {
+    const double s = STREAM_SCALAR;
+    switch (kernel) {
+    case STREAM_COPY:
+        for (long i = lb; i < ub; i++) c[i] = a[i];
+        break;
+    case STREAM_SCALE:
+        for (long i = lb; i < ub; i++) b[i] = s * c[i];
+        break;
+    case STREAM_ADD:
+        for (long i = lb; i < ub; i++) c[i] = a[i] + b[i];
+        break;
+    default:
+        for (long i = lb; i < ub; i++) a[i] = b[i] + s * c[i];
+        break;
+    }
+}
+
+// Случайный цикл (алгоритм Саттоло) по строкам кэша [lb, ub) массива
+// next: в слове line * 8 - индекс следующего слова. Цикл один на весь
+// кусок, так что предвыборка не угадывает адрес, а кэш не помогает.
+static inline void stream_chase_build(size_t *next, long lb, long ub, uint64_t seed) {
+    long lines = ub - lb;
+    if (lines <= 0) {
+        return;
+    }
+    long *order = (long*)malloc(sizeof(long) * lines);
+    for (long k = 0; k < lines; k++) {
+        order[k] = lb + k;
+    }
+    uint64_t x = seed * 0x9E3779B97F4A7C15ull + 1;
+    for (long k = lines - 1; k > 0; k--) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        long j = (long)(x % (uint64_t)k); // j < k - один цикл
+        long t = order[k];
+        order[k] = order[j];
+        order[j] = t;
+    }
+    for (long k = 0; k < lines; k++) {
+        next[order[k] * STREAM_LINE_WORDS] = (size_t)order[(k + 1) % lines] * STREAM_LINE_WORDS;
+    }
+    free(order);
+}
+
+// steps переходов от начала куска, возвращает конечный индекс (чтобы
+// компилятор не выбросил цикл)
+static inline size_t stream_chase_run(const size_t *next, long lb, long steps) {
+    size_t p = (size_t)lb * STREAM_LINE_WORDS;
+    for (long k = 0; k < steps; k++) {
+        p = next[p];
+    }
+    return p;
+}
+
+static inline void stream_print_header(void) {
+    printf("%8s %10s %10s %10s %10s %12s\n", "threads", "copy GB/s", "scale GB/s", "add GB/s", "triad GB/s",
+           "latency ns");
+}
+
+static inline void stream_print_row(const stream_result_t *r) {
+    printf("%8d %10.3f %10.3f %10.3f %10.3f %12.2f\n", r->threads, r->gbs[STREAM_COPY], r->gbs[STREAM_SCALE],
+           r->gbs[STREAM_ADD], r->gbs[STREAM_TRIAD], r->latency_ns);
+}
+
+static inline void stream_table_add(stream_table_t *table, const stream_result_t *r) {
+    for (int k = 0; k < table->count; k++) {
+        if (table->rows[k].threads == r->threads) {
+            table->rows[k] = *r;
+            return;
+        }
+    }
+    if (table->count < STREAM_MAX_ROWS) {
+        table->rows[table->count++] = *r;
+    }
+}
+
+static inline int stream_table_save(const stream_table_t *table, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    fprintf(f, "threads,copy_gbs,scale_gbs,add_gbs,triad_gbs,latency_ns\n");
+    for (int k = 0; k < table->count; k++) {
+        const stream_result_t *r = &table->rows[k];
+        fprintf(f, "%d,%.6f,%.6f,%.6f,%.6f,%.6f\n", r->threads, r->gbs[STREAM_COPY], r->gbs[STREAM_SCALE],
+                r->gbs[STREAM_ADD], r->gbs[STREAM_TRIAD], r->latency_ns);
+    }
+    fclose(f);
+    return 0;
+}
+
+// 0 - прочитано (хотя бы одна строка), -1 - файла нет или он пуст
+static inline int stream_table_load(stream_table_t *table, const char *path) {
+    table->count = 0;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        stream_result_t r;
+        if (sscanf(line, "%d,%lf,%lf,%lf,%lf,%lf", &r.threads, &r.gbs[STREAM_COPY], &r.gbs[STREAM_SCALE],
+                   &r.gbs[STREAM_ADD], &r.gbs[STREAM_TRIAD], &r.latency_ns) == 6) {
+            stream_table_add(table, &r);
+        }
+    }
+    fclose(f);
+    return table->count > 0 ? 0 : -1;
+}
+
+// Строка калибровки для threads потоков: точное совпадение, иначе
+// ближайшая меньшая, иначе наименьшая. NULL - таблица пуста.
+static inline const stream_result_t *stream_lookup(const stream_table_t *table, int threads) {
+    const stream_result_t *below = NULL, *lowest = NULL;
+    for (int k = 0; k < table->count; k++) {
+        const stream_result_t *r = &table->rows[k];
+        if (r->threads <= threads && (!below || r->threads > below->threads)) {
+            below = r;
+        }
+        if (!lowest || r->threads < lowest->threads) {
+            lowest = r;
+        }
+    }
+    return below ? below : lowest;
+}
+
+// достижимая пропускная способность - лучшее из ядер STREAM; kernel - какое
+static inline double stream_attainable(const stream_result_t *r, int *kernel) {
+    int best = 0;
+    for (int k = 1; k < STREAM_KERNELS; k++) {
+        if (r->gbs[k] > r->gbs[best]) {
+            best = k;
+        }
+    }
+    if (kernel) {
+        *kernel = best;
+    }
+    return r->gbs[best];
+}
+
+// "  [name] 63.2% of attainable bandwidth (STREAM copy 11.4 GB/s at 8 threads, latency 92.1 ns)"
+static inline void stream_print_fraction(const stream_table_t *table, const char *name, double gbs, int threads) {
+    const stream_result_t *r = stream_lookup(table, threads);
+    if (!r) {
+        return;
+    }
+    int kernel;
+    double peak = stream_attainable(r, &kernel);
+    printf("  [%s] %.1f%% of attainable bandwidth (STREAM %s %.3f GB/s at %d threads, latency %.1f ns)\n", name,
+           100.0 * gbs / peak, stream_names[kernel], peak, r->threads, r->latency_ns);
+}